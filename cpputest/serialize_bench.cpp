@@ -0,0 +1,118 @@
+// FetchPostOp serialization: Post model + json DOM + dump() vs PgJson::RowWriter.
+// Rows are built client side with PQsetvalue, no database needed. Exits non zero when the
+// two bodies differ.
+//
+//   SerializeBench [rows ...]
+//   SerializeBench 1000 10000 100000
+#include "../livepostsvc/routes/PgJson.h"
+#include "livepostsmodel/model.h"
+#include "livepostsmodel/pq.h"
+#include <nlohmann/json.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+struct ColumnSpec
+{
+  const char *name;
+  Oid type;
+};
+
+// Same columns and types as FetchPostOp::pageSql
+static const std::vector<ColumnSpec> COLUMNS = {
+    {"id", 23}, {"title", 25}, {"slug", 25}, {"content", 25}, {"userId", 23}, {"date", 1114}, {"thumbsUp", 23}, {"hooray", 23}, {"heart", 23}, {"rocket", 23}, {"eyes", 23}, {"allocated", 16}, {"live", 16}, {"userName", 25}};
+
+static std::unique_ptr<PGresult, decltype(&PQclear)> makePosts(int rows)
+{
+  std::unique_ptr<PGresult, decltype(&PQclear)> res(PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK), &PQclear);
+  std::vector<PGresAttDesc> attrs;
+  for (const auto &column : COLUMNS)
+    attrs.push_back(PGresAttDesc{const_cast<char *>(column.name), 0, 0, 0, column.type, -1, -1});
+  PQsetResultAttrs(res.get(), static_cast<int>(attrs.size()), attrs.data());
+
+  const std::string content = "Their bird was, in this moment, a silly bear. They were lost without the amicable kiwi "
+                              "that composed their fox. \"A peach\" is an amicable crocodile.\nA tidy fox without sharks "
+                              "is truly a scorpion of willing cats. Shouting with happiness, a currant is a wise currant!";
+  for (int row = 0; row < rows; row++)
+  {
+    std::vector<std::string> values = {
+        std::to_string(row + 1), "Some tough spiders are thought of simply as figs " + std::to_string(row),
+        "some-tough-spiders-" + std::to_string(row), content, "1", "2024-05-01 10:11:12.123",
+        "3", "0", "12", "1", "7", "t", "t", "Temp User at Hello co nz"};
+    for (int col = 0; col < static_cast<int>(values.size()); col++)
+      PQsetvalue(res.get(), row, col, values[col].data(), static_cast<int>(values[col].size()));
+  }
+  return res;
+}
+
+template <typename Fn>
+static double bestMs(int repeats, Fn &&fn)
+{
+  double best = 1e300;
+  for (int i = 0; i < repeats; i++)
+  {
+    auto start = Clock::now();
+    fn();
+    best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<int> sizes;
+  for (int i = 1; i < argc; i++)
+    sizes.push_back(std::atoi(argv[i]));
+  if (sizes.empty())
+    sizes = {1000, 10000, 100000};
+
+  int mismatches = 0;
+  for (int rows : sizes)
+  {
+    auto res = makePosts(rows);
+    int cols = PQnfields(res.get());
+    std::string domBody, writerBody;
+
+    double dom = bestMs(5, [&]
+                        {
+                          json root;
+                          root["fetchPosts"] = json::array();
+                          for (int row = 0; row < rows; row++)
+                          {
+                            LivePostsModel::Post post = LivePostsModel::PG::Posts::fromPGRes(res.get(), cols, row);
+                            root["fetchPosts"].push_back(post);
+                          }
+                          domBody = root.dump(); });
+
+    double writer = bestMs(5, [&]
+                           {
+                             Routes::PgJson::RowWriter rowWriter(res.get());
+                             std::string body;
+                             body.reserve(rowWriter.estimate(0, rows) + 16);
+                             body += "{\"fetchPosts\":";
+                             rowWriter.appendArray(body, 0, rows);
+                             body += '}';
+                             writerBody = std::move(body); });
+
+    std::cout << rows << " rows\tmodel+dom " << dom << " ms (" << domBody.size() << " B)"
+              << "\trow writer " << writer << " ms (" << writerBody.size() << " B)"
+              << "\tspeedup " << dom / writer << "x\n";
+
+    if (domBody != writerBody)
+    {
+      auto at = std::mismatch(domBody.begin(), domBody.end(), writerBody.begin(), writerBody.end()).first - domBody.begin();
+      std::cerr << rows << " rows: bodies differ at byte " << at << "\n  model+dom  " << domBody.substr(at, 80)
+                << "\n  row writer " << writerBody.substr(at, 80) << "\n";
+      mismatches++;
+    }
+  }
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
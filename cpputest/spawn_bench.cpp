@@ -0,0 +1,97 @@
+// Spawn latency of the prerender launchers (fork vs posix_spawn) as the parent's RSS grows.
+//
+//   SpawnBench [iterations] [program] [rss MB ...]
+//   SpawnBench 200 /bin/true 0 256 1024
+#include "../livepostsvc/prerender/Process.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+using Prerender::Launcher;
+
+struct Sample
+{
+  std::vector<double> spawnUs; // spawn_child returning
+  std::vector<double> totalUs; // spawn through child exit
+};
+
+static double percentile(std::vector<double> sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  std::sort(sorted.begin(), sorted.end());
+  auto rank = static_cast<std::size_t>(p * (sorted.size() - 1));
+  return sorted[rank];
+}
+
+static Sample run(Launcher launcher, const std::string &program, int iterations)
+{
+  Sample sample;
+  for (int i = 0; i < iterations; i++)
+  {
+    auto start = Clock::now();
+    Prerender::ChildPipes child = Prerender::spawn_child(program, {program}, {}, launcher);
+    auto spawned = Clock::now();
+    if (child.pid == -1)
+    {
+      std::cerr << "spawn failed\n";
+      std::exit(EXIT_FAILURE);
+    }
+
+    close(child.in);
+    char buffer[256];
+    while (read(child.out, buffer, sizeof(buffer)) > 0)
+    {
+    }
+    close(child.out);
+    int status;
+    waitpid(child.pid, &status, 0);
+    auto done = Clock::now();
+
+    sample.spawnUs.push_back(std::chrono::duration<double, std::micro>(spawned - start).count());
+    sample.totalUs.push_back(std::chrono::duration<double, std::micro>(done - start).count());
+  }
+  return sample;
+}
+
+static void report(const char *name, std::size_t rssMB, const Sample &sample)
+{
+  std::cout << name << "\t" << rssMB << " MB"
+            << "\tspawn p50 " << percentile(sample.spawnUs, 0.50) << "us"
+            << " p99 " << percentile(sample.spawnUs, 0.99) << "us"
+            << "\ttotal p50 " << percentile(sample.totalUs, 0.50) << "us"
+            << " p99 " << percentile(sample.totalUs, 0.99) << "us\n";
+}
+
+int main(int argc, char **argv)
+{
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+  std::string program = argc > 2 ? argv[2] : "/bin/true";
+  std::vector<std::size_t> sizesMB;
+  for (int i = 3; i < argc; i++)
+    sizesMB.push_back(std::strtoul(argv[i], nullptr, 10));
+  if (sizesMB.empty())
+    sizesMB = {0, 256, 1024};
+
+  std::cout << "default launcher: "
+            << (Prerender::default_launcher() == Launcher::PosixSpawn ? "posix_spawn" : "fork") << "\n";
+
+  std::vector<char> ballast;
+  for (auto sizeMB : sizesMB)
+  {
+    // Touch every page so it is resident and has to be mapped in a forked child
+    ballast.assign(sizeMB * 1024 * 1024, 0);
+    std::memset(ballast.data(), 1, ballast.size());
+
+    report("fork", sizeMB, run(Launcher::Fork, program, iterations));
+    report("posix_spawn", sizeMB, run(Launcher::PosixSpawn, program, iterations));
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+#include "AuthorCache.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace Cache
+{
+
+  AuthorCache::AuthorCache(std::size_t maxEntries, std::chrono::seconds ttl, std::size_t shards)
+      : maxPerShard_(std::max<std::size_t>(1, maxEntries / std::max<std::size_t>(1, shards))),
+        ttl_(ttl),
+        hits_(Metrics::registry().counter("author_cache_hits_total", "Author lookups answered from the cache")),
+        misses_(Metrics::registry().counter("author_cache_misses_total", "Author lookups that went to Postgres")),
+        evictedCapacity_(Metrics::registry().counter("author_cache_evictions_total", "Authors dropped from the cache",
+                                                     {{"reason", "capacity"}})),
+        evictedExpired_(Metrics::registry().counter("author_cache_evictions_total", "Authors dropped from the cache",
+                                                    {{"reason", "expired"}})),
+        size_(Metrics::registry().gauge("author_cache_entries", "Authors held in the cache"))
+  {
+    shards_.reserve(std::max<std::size_t>(1, shards));
+    for (std::size_t i = 0; i < std::max<std::size_t>(1, shards); i++)
+      shards_.push_back(std::make_unique<Shard>());
+  }
+
+  AuthorCache::Shard &AuthorCache::shardFor(const std::string &authId)
+  {
+    return *shards_[std::hash<std::string>{}(authId) % shards_.size()];
+  }
+
+  std::optional<LivePostsModel::User> AuthorCache::get(const std::string &authId)
+  {
+    Shard &shard = shardFor(authId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(authId);
+    if (it == shard.index.end())
+    {
+      misses_.inc();
+      return std::nullopt;
+    }
+
+    if (it->second->second.expires <= Clock::now())
+    {
+      shard.lru.erase(it->second);
+      shard.index.erase(it);
+      size_.add(-1);
+      evictedExpired_.inc();
+      misses_.inc();
+      return std::nullopt;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    hits_.inc();
+    return it->second->second.user;
+  }
+
+  void AuthorCache::put(const LivePostsModel::User &user)
+  {
+    Shard &shard = shardFor(user.authId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Entry entry{user, Clock::now() + ttl_};
+
+    auto it = shard.index.find(user.authId);
+    if (it != shard.index.end())
+    {
+      it->second->second = std::move(entry);
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      return;
+    }
+
+    if (shard.lru.size() >= maxPerShard_)
+    {
+      shard.index.erase(shard.lru.back().first);
+      shard.lru.pop_back();
+      size_.add(-1);
+      evictedCapacity_.inc();
+    }
+    shard.lru.emplace_front(user.authId, std::move(entry));
+    shard.index.emplace(user.authId, shard.lru.begin());
+    size_.add(1);
+  }
+
+  std::size_t AuthorCache::size() const
+  {
+    std::size_t total = 0;
+    for (const auto &shard : shards_)
+    {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      total += shard->lru.size();
+    }
+    return total;
+  }
+
+  std::uint64_t AuthorCache::version() const
+  {
+    return version_.load();
+  }
+
+  void AuthorCache::bump()
+  {
+    version_++;
+  }
+
+  AuthorCache &authorCache()
+  {
+    static AuthorCache cache(10000, std::chrono::minutes(5));
+    return cache;
+  }
+
+}
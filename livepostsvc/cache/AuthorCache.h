@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../metrics/Metrics.h"
+#include "livepostsmodel/model.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Cache
+{
+
+  // Users by authId. Keys hash to one of a fixed number of shards, each an LRU under its own
+  // mutex, so lookups from different sessions rarely contend. Entries expire ttl after put;
+  // the users table has no update route, the ttl bounds staleness from outside edits.
+  class AuthorCache
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    AuthorCache(std::size_t maxEntries, std::chrono::seconds ttl, std::size_t shards = 16);
+
+    std::optional<LivePostsModel::User> get(const std::string &authId);
+    void put(const LivePostsModel::User &user);
+    std::size_t size() const;
+
+    // Bumped by writes to the users table. Entries are kept (a write only adds a user); the
+    // version keys authorsFlight() so a fetch after a write never joins a query from before it.
+    std::uint64_t version() const;
+    void bump();
+
+  private:
+    struct Entry
+    {
+      LivePostsModel::User user;
+      Clock::time_point expires;
+    };
+    using Lru = std::list<std::pair<std::string, Entry>>; // most recently used first
+
+    struct Shard
+    {
+      mutable std::mutex mutex;
+      Lru lru;
+      std::unordered_map<std::string, Lru::iterator> index;
+    };
+
+    Shard &shardFor(const std::string &authId);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::size_t maxPerShard_;
+    std::chrono::seconds ttl_;
+    std::atomic<std::uint64_t> version_{0};
+
+    Metrics::Counter &hits_;
+    Metrics::Counter &misses_;
+    Metrics::Counter &evictedCapacity_;
+    Metrics::Counter &evictedExpired_;
+    Metrics::Gauge &size_;
+  };
+
+  // GET /api/v1/liveposts/user/fetchbyauthid/{authId}, filled by author create
+  AuthorCache &authorCache();
+
+}
@@ -0,0 +1,67 @@
+#include "ResponseCache.h"
+
+#include <mutex>
+#include <utility>
+
+namespace Cache
+{
+
+  ResponseCache::ResponseCache(const std::string &name, std::size_t maxEntries, std::chrono::seconds ttl)
+      : maxEntries_(maxEntries),
+        ttl_(ttl),
+        hits_(Metrics::registry().counter("response_cache_hits_total", "Responses served from the in-process cache",
+                                          {{"cache", name}})),
+        misses_(Metrics::registry().counter("response_cache_misses_total", "Responses that had to be built",
+                                            {{"cache", name}}))
+  {
+  }
+
+  std::uint64_t ResponseCache::version() const
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return version_;
+  }
+
+  void ResponseCache::bump()
+  {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    version_++;
+    entries_.clear();
+  }
+
+  std::shared_ptr<const ResponseCache::Response> ResponseCache::get(const std::string &key)
+  {
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex_);
+      auto it = entries_.find(key);
+      // An expired entry stays until put() replaces it or bump() clears it
+      if (it != entries_.end() && it->second.version == version_ && it->second.expires > Clock::now())
+      {
+        hits_.inc();
+        return it->second.response;
+      }
+    }
+    misses_.inc();
+    return nullptr;
+  }
+
+  void ResponseCache::put(const std::string &key, std::uint64_t version, std::string body, std::string etag)
+  {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (version != version_)
+      return; // data changed while the body was built
+
+    if (entries_.size() >= maxEntries_ && !entries_.contains(key))
+    {
+      entries_.clear(); // cheap bound; pages are rebuilt on the next miss
+    }
+    entries_[key] = Entry{version, Clock::now() + ttl_, std::make_shared<const Response>(Response{std::move(body), std::move(etag)})};
+  }
+
+  ResponseCache &postsCache()
+  {
+    static ResponseCache cache("fetchPosts", 1024, std::chrono::seconds(30));
+    return cache;
+  }
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../metrics/Metrics.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Cache
+{
+
+  // Serialized response bodies tagged with the data version they were built from.
+  // bump() drops every entry at once; put() with an older version is ignored so a query
+  // that raced a write never caches its stale rows. Entries also expire ttl after put, which
+  // bounds how long rows written elsewhere (another instance, a lagging replica) are served.
+  class ResponseCache
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // name labels response_cache_{hits,misses}_total{cache=name}
+    ResponseCache(const std::string &name, std::size_t maxEntries, std::chrono::seconds ttl);
+
+    std::uint64_t version() const;
+    void bump();
+
+    struct Response
+    {
+      std::string body;
+      std::string etag;
+    };
+
+    // nullptr on a miss
+    std::shared_ptr<const Response> get(const std::string &key);
+    void put(const std::string &key, std::uint64_t version, std::string body, std::string etag);
+
+  private:
+    struct Entry
+    {
+      std::uint64_t version;
+      Clock::time_point expires;
+      std::shared_ptr<const Response> response;
+    };
+
+    std::size_t maxEntries_;
+    std::chrono::seconds ttl_;
+    mutable std::shared_mutex mutex_;
+    std::uint64_t version_ = 0;
+    std::unordered_map<std::string, Entry> entries_;
+
+    Metrics::Counter &hits_;
+    Metrics::Counter &misses_;
+  };
+
+  // GET /api/v1/liveposts/posts pages, bumped by post create and stage commits
+  ResponseCache &postsCache();
+
+}
@@ -0,0 +1,56 @@
+#include "SingleFlight.h"
+
+#include <utility>
+
+namespace Cache
+{
+
+  SingleFlight::SingleFlight(const std::string &name)
+      : coalesced_(Metrics::registry().counter("singleflight_coalesced_total",
+                                               "Requests answered with another request's in-flight query",
+                                               {{"flight", name}}))
+  {
+  }
+
+  bool SingleFlight::join(const std::string &key, Waiter waiter)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = flights_.find(key);
+    if (it == flights_.end())
+    {
+      flights_.emplace(key, std::vector<Waiter>{});
+      return true;
+    }
+    it->second.push_back(std::move(waiter));
+    coalesced_.inc();
+    return false;
+  }
+
+  void SingleFlight::finish(const std::string &key, std::shared_ptr<const FlightResult> result)
+  {
+    std::vector<Waiter> waiters;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = flights_.find(key);
+      if (it == flights_.end())
+        return;
+      waiters = std::move(it->second);
+      flights_.erase(it);
+    }
+    for (auto &waiter : waiters)
+      waiter(result);
+  }
+
+  SingleFlight &postsFlight()
+  {
+    static SingleFlight flight("fetchPosts");
+    return flight;
+  }
+
+  SingleFlight &authorsFlight()
+  {
+    static SingleFlight flight("fetchAuthor");
+    return flight;
+  }
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../metrics/Metrics.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Cache
+{
+
+  // What the leading request answered; followers send the same bytes
+  struct FlightResult
+  {
+    std::string error; // empty on success
+    std::string body;
+    std::string etag;
+  };
+
+  // Coalesces identical reads in flight. The first join() for a key leads: it runs the query
+  // and must finish() the key on every outcome. Later joins for the key, until then, only
+  // queue their waiter, which finish() calls with the leader's result (on the finishing
+  // thread, outside the lock).
+  class SingleFlight
+  {
+  public:
+    using Waiter = std::function<void(std::shared_ptr<const FlightResult>)>;
+
+    // name labels singleflight_coalesced_total{flight=name}
+    explicit SingleFlight(const std::string &name);
+
+    // True when the caller leads; waiter is only kept when it follows
+    bool join(const std::string &key, Waiter waiter);
+    void finish(const std::string &key, std::shared_ptr<const FlightResult> result);
+
+  private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<Waiter>> flights_;
+
+    Metrics::Counter &coalesced_;
+  };
+
+  // Keyed by the postsCache() key / authId, each with its cache's version appended so joins
+  // after a write start a new flight
+  SingleFlight &postsFlight();
+  SingleFlight &authorsFlight();
+
+}
@@ -0,0 +1,180 @@
+#include "Compress.h"
+
+#include <zlib.h>
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#include <cctype>
+#include <cstdlib>
+#include <optional>
+
+namespace Compress
+{
+
+  const char *name(Encoding encoding)
+  {
+    switch (encoding)
+    {
+    case Encoding::Gzip:
+      return "gzip";
+    case Encoding::Deflate:
+      return "deflate";
+    case Encoding::Brotli:
+      return "br";
+    case Encoding::Identity:
+      break;
+    }
+    return "identity";
+  }
+
+  const char *suffix(Encoding encoding)
+  {
+    switch (encoding)
+    {
+    case Encoding::Gzip:
+      return ".gz";
+    case Encoding::Brotli:
+      return ".br";
+    case Encoding::Deflate:
+    case Encoding::Identity:
+      break;
+    }
+    return "";
+  }
+
+  static std::string zlibCompress(std::string_view data, int level, int windowBits)
+  {
+    z_stream strm{};
+    if (deflateInit2(&strm, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      throw CompressError("deflateInit2 failed");
+    }
+
+    std::string out;
+    out.resize(deflateBound(&strm, static_cast<uLong>(data.size())));
+    strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    strm.avail_in = static_cast<uInt>(data.size());
+    strm.next_out = reinterpret_cast<Bytef *>(out.data());
+    strm.avail_out = static_cast<uInt>(out.size());
+
+    int rc = ::deflate(&strm, Z_FINISH);
+    out.resize(strm.total_out);
+    deflateEnd(&strm);
+    if (rc != Z_STREAM_END)
+    {
+      throw CompressError("deflate failed");
+    }
+    return out;
+  }
+
+  std::string gzip(std::string_view data, int level)
+  {
+    return zlibCompress(data, level, 15 + 16); // +16: gzip header and trailer
+  }
+
+  std::string deflate(std::string_view data, int level)
+  {
+    return zlibCompress(data, level, 15); // HTTP "deflate" is the zlib format
+  }
+
+  std::string brotli(std::string_view data, int quality)
+  {
+#ifdef HAVE_BROTLI
+    std::string out;
+    size_t size = BrotliEncoderMaxCompressedSize(data.size());
+    out.resize(size == 0 ? data.size() + 1024 : size);
+    if (!BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               data.size(), reinterpret_cast<const uint8_t *>(data.data()),
+                               &size, reinterpret_cast<uint8_t *>(out.data())))
+    {
+      throw CompressError("BrotliEncoderCompress failed");
+    }
+    out.resize(size);
+    return out;
+#else
+    (void)data;
+    (void)quality;
+    throw CompressError("Built without brotli");
+#endif
+  }
+
+  bool brotliAvailable()
+  {
+#ifdef HAVE_BROTLI
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  std::string encode(Encoding encoding, std::string_view data, int level)
+  {
+    switch (encoding)
+    {
+    case Encoding::Gzip:
+      return gzip(data, level);
+    case Encoding::Deflate:
+      return deflate(data, level);
+    case Encoding::Brotli:
+      return brotli(data, level);
+    case Encoding::Identity:
+      break;
+    }
+    return std::string(data);
+  }
+
+  static bool iequals(std::string_view a, std::string_view b)
+  {
+    if (a.size() != b.size())
+      return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+    {
+      if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+        return false;
+    }
+    return true;
+  }
+
+  static std::string_view trim(std::string_view s)
+  {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+      s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+      s.remove_suffix(1);
+    return s;
+  }
+
+  bool accepts(std::string_view acceptEncoding, std::string_view coding)
+  {
+    std::optional<bool> wildcard;
+    while (!acceptEncoding.empty())
+    {
+      auto comma = acceptEncoding.find(',');
+      std::string_view item = acceptEncoding.substr(0, comma);
+      acceptEncoding = comma == std::string_view::npos ? std::string_view{} : acceptEncoding.substr(comma + 1);
+
+      // coding [; q=value]
+      std::string_view token = item;
+      bool allowed = true;
+      auto semi = item.find(';');
+      if (semi != std::string_view::npos)
+      {
+        token = item.substr(0, semi);
+        std::string_view param = trim(item.substr(semi + 1));
+        if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=')
+        {
+          allowed = std::strtod(std::string(param.substr(2)).c_str(), nullptr) > 0.0;
+        }
+      }
+      token = trim(token);
+
+      if (iequals(token, coding))
+        return allowed;
+      if (token == "*")
+        wildcard = allowed;
+    }
+    return wildcard.value_or(false);
+  }
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace Compress
+{
+
+  class CompressError : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  enum class Encoding
+  {
+    Identity,
+    Gzip,
+    Deflate,
+    Brotli
+  };
+
+  // Content-Encoding token and precompressed file suffix
+  const char *name(Encoding encoding);
+  const char *suffix(Encoding encoding);
+
+  // level 1..9 (zlib), quality 0..11 (brotli)
+  std::string gzip(std::string_view data, int level);
+  std::string deflate(std::string_view data, int level);
+  std::string brotli(std::string_view data, int quality);
+  bool brotliAvailable();
+
+  std::string encode(Encoding encoding, std::string_view data, int level);
+
+  // True when an Accept-Encoding header allows coding (q=0 refuses, "*" matches)
+  bool accepts(std::string_view acceptEncoding, std::string_view coding);
+
+}
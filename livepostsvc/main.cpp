@@ -6,8 +6,14 @@
 #include <boost/asio/signal_set.hpp>
 #include <boost/program_options.hpp>
 #include <thread>
+#include <algorithm>
 #include <chrono>
 #include "routes/Routes.h"
+#include "routes/Compression.h"
+#include "prerender/Pipeline.h"
+#include "prerender/Precompress.h"
+#include "prerender/RenderCache.h"
+#include "rebuild/SiteRebuild.h"
 #include <redis_pubsub/publish/Publish.h> // RedisPublish class
 #include <mtlog/mt_log.hpp>
 #include <boost/redis/src.hpp> // boost redis implementation
@@ -15,6 +21,7 @@
 #include <iostream>
 #include <system_error>
 #include <unistd.h>
+#include <csignal>
 
 namespace net = boost::asio;      // from <boost/asio.hpp>
 using tcp = boost::asio::ip::tcp; // from <boost/asio/ip/tcp.hpp>
@@ -155,6 +162,27 @@ po::variables_map parse_args(int &argc, char *argv[])
       ("address", po::value<std::string>()->default_value("0.0.0.0"), "set listening address") //
       ("port", po::value<std::uint16_t>()->default_value(port), "set listening port")          //
       ("threads", po::value<std::uint16_t>()->default_value(8), "set number threads")          //
+      ("prerender-workers", po::value<std::uint16_t>()->default_value(0),
+       "persistent prerender node workers (0 = fork/exec per stage)")                          //
+      ("prerender-threads", po::value<std::uint16_t>()->default_value(0),
+       "threads running prerenders and folder swaps (0 = same as --threads)")                 //
+      ("prerender-timeout-ms", po::value<std::uint32_t>()->default_value(30000),
+       "kill a prerender that has not answered after this long (0 = never)")                  //
+      ("precompress-threads", po::value<std::uint16_t>()->default_value(0),
+       "threads writing .gz/.br siblings of published posts for a proxy (0 = off)")           //
+      ("compress-level", po::value<int>()->default_value(6),
+       "gzip/deflate level for JSON responses (0 = off)")                                     //
+      ("compress-min-bytes", po::value<std::size_t>()->default_value(1024),
+       "smallest response body worth compressing")                                             //
+      ("compress-threads", po::value<std::uint16_t>()->default_value(1),
+       "threads compressing large responses (0 = on the ASIO threads)")                         //
+      ("replica-select", po::value<std::string>()->default_value("round-robin"),
+       "replica pool choice for reads: round-robin or least-busy")                             //
+      ("replica-write-window-ms", po::value<std::uint32_t>()->default_value(1000),
+       "reads stay on the primary this long after a write")                                    //
+      ("rebuild-site", "prerender every live post, report timings and exit")                   //
+      ("rebuild-concurrency", po::value<std::uint16_t>()->default_value(2),
+       "batches in flight during --rebuild-site")                                              //
       ("root", po::value<std::string>()->default_value("latest"), "document root folder");     //
 
   po::variables_map vm;
@@ -175,6 +203,10 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
+  // A prerender child or pooled worker that dies while we write its stdin must surface as EPIPE,
+  // not kill the service. Set once here, before any thread or child process exists.
+  signal(SIGPIPE, SIG_IGN);
+
   // Check command line arguments.
   try
   {
@@ -232,6 +264,12 @@ int main(int argc, char *argv[])
     auto address = net::ip::make_address(vm["address"].as<std::string>());
     auto port = vm["port"].as<std::uint16_t>();
     auto threads = vm["threads"].as<std::uint16_t>();
+    auto prerender_workers = vm["prerender-workers"].as<std::uint16_t>();
+    auto prerender_threads = vm["prerender-threads"].as<std::uint16_t>();
+    if (prerender_threads == 0)
+      prerender_threads = threads;
+    auto precompress_threads = vm["precompress-threads"].as<std::uint16_t>();
+    auto prerender_timeout = std::chrono::milliseconds(vm["prerender-timeout-ms"].as<std::uint32_t>());
     auto const doc_root = std::make_shared<std::string>(vm["root"].as<std::string>());
 
     mt_logging::logger().log(
@@ -248,6 +286,24 @@ int main(int argc, char *argv[])
     try
     {
       prerenderSelfTest();
+      Prerender::renderCache().load(*doc_root);
+      Prerender::setRenderTimeout(prerender_timeout);
+      Prerender::startWorkerPool(prerender_workers);
+      // Sized apart from the worker pool: with fork/exec renders (workers 0) concurrent stages
+      // still render in parallel. Each rebuild batch holds a pipeline thread for its whole render.
+      auto pipeline_threads = prerender_threads;
+      if (vm.count("rebuild-site"))
+      {
+        auto rebuild_concurrency = vm["rebuild-concurrency"].as<std::uint16_t>();
+        if (prerender_workers > 0 && rebuild_concurrency > prerender_workers)
+          mt_logging::logger().log({fmt::format("--rebuild-concurrency {} is above --prerender-workers {}, extra batches wait for a worker",
+                                                rebuild_concurrency, prerender_workers),
+                                    mt_logging::LogLevel::Error,
+                                    true});
+        pipeline_threads = std::max(prerender_threads, rebuild_concurrency);
+      }
+      Prerender::startPipeline(pipeline_threads);
+      Prerender::startPrecompress(precompress_threads);
     }
     catch (const std::exception &e)
     {
@@ -257,6 +313,45 @@ int main(int argc, char *argv[])
       return EXIT_FAILURE;
     }
 
+    if (vm.count("rebuild-site"))
+    {
+      Rebuild::Options options;
+      options.dbname = std::string(apidb_name);
+      options.host = std::string(apidb_host);
+      options.user = std::string(apidb_user);
+      options.password = std::string(apidb_password);
+      options.port = std::string(apidb_port);
+      options.concurrency = vm["rebuild-concurrency"].as<std::uint16_t>();
+
+      Rebuild::Report report;
+      try
+      {
+        report = Rebuild::rebuildSite(options);
+      }
+      catch (const std::exception &e)
+      {
+        mt_logging::logger().log({fmt::format("Rebuild site error {}", e.what()),
+                                  mt_logging::LogLevel::Error,
+                                  true});
+        report.failed++;
+      }
+      Prerender::stopPipeline();
+      Prerender::stopPrecompress(); // waits for the .gz/.br siblings
+      Prerender::stopWorkerPool();
+
+      std::cout << fmt::format("Rebuilt {} posts ({} failed) in {:.2f}s: {:.1f} posts/s, per post p50 {:.1f}ms, p99 {:.1f}ms",
+                               report.posts, report.failed, report.seconds,
+                               report.postsPerSecond, report.p50Ms, report.p99Ms)
+                << std::endl;
+      return report.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    Routes::CompressionOptions compression;
+    compression.level = std::clamp(vm["compress-level"].as<int>(), 0, 9);
+    compression.minBytes = vm["compress-min-bytes"].as<std::size_t>();
+    compression.threads = vm["compress-threads"].as<std::uint16_t>();
+    Routes::startResponseCompression(compression);
+
     // The io_context is required for all I/O
     net::io_context ioc{threads};
 
@@ -276,6 +371,46 @@ int main(int argc, char *argv[])
     cfg.password = std::string(apidb_password);
     cfg.port = std::string(apidb_port);
     auto pq_pool = std::make_shared<PQClientPool>(ioc, cfg);
+    Routes::setDbPool(pq_pool); // routes that borrow a connection only when needed
+
+    // Optional read replicas: APIDB_REPLICA_HOST is a comma separated host list; port, user,
+    // password and database default to the primary's
+    std::vector<std::shared_ptr<PQClientPool>> replica_pools;
+    if (auto replica_hosts = std::getenv("APIDB_REPLICA_HOST"))
+    {
+      auto env_or = [](const char *name, const char *fallback)
+      {
+        auto value = std::getenv(name);
+        return std::string(value != nullptr ? value : fallback);
+      };
+      std::string_view hosts(replica_hosts);
+      while (!hosts.empty())
+      {
+        auto comma = hosts.find(',');
+        std::string host(hosts.substr(0, comma));
+        hosts = comma == std::string_view::npos ? std::string_view() : hosts.substr(comma + 1);
+        if (host.empty())
+          continue;
+
+        PQClientPool::Config replica_cfg = cfg;
+        replica_cfg.host = host;
+        replica_cfg.port = env_or("APIDB_REPLICA_PORT", apidb_port);
+        replica_cfg.user = env_or("APIDB_REPLICA_USER", apidb_user);
+        replica_cfg.password = env_or("APIDB_REPLICA_PASSWORD", apidb_password);
+        replica_cfg.dbname = env_or("APIDB_REPLICA_NAME", apidb_name);
+        replica_pools.push_back(std::make_shared<PQClientPool>(ioc, replica_cfg));
+      }
+    }
+    auto replica_select = vm["replica-select"].as<std::string>();
+    if (replica_select != "round-robin" && replica_select != "least-busy")
+      throw std::invalid_argument("--replica-select must be round-robin or least-busy");
+    mt_logging::logger().log({fmt::format("Read replicas: {} ({})", replica_pools.size(), replica_select),
+                              mt_logging::LogLevel::Info,
+                              true});
+    Routes::setReplicaPools(std::move(replica_pools),
+                            replica_select == "least-busy" ? Routes::ReplicaSelect::LeastBusy
+                                                           : Routes::ReplicaSelect::RoundRobin,
+                            std::chrono::milliseconds(vm["replica-write-window-ms"].as<std::uint32_t>()));
 
     auto restserver = std::make_shared<RestServer>(
         ioc,
@@ -285,11 +420,12 @@ int main(int argc, char *argv[])
         wsclient_manager,
         pq_pool);
 
-    restserver->get("/health", "", Rest::DbRequirement::Required, Routes::LivePosts::healthCheck);
+    restserver->get("/health", "", Rest::DbRequirement::None, Routes::LivePosts::healthCheck); // borrows a read connection itself
+    restserver->get("/metrics", "", Rest::DbRequirement::None, Routes::LivePosts::metrics); // Prometheus text format
     restserver->get("/api/v1/liveposts/homepage", "", Rest::DbRequirement::Required, Routes::LivePosts::homePage); // non DB just hard coded page data
 
     // Public url to fetch posts for the web
-    restserver->get("/api/v1/liveposts/posts", "", Rest::DbRequirement::Required, Routes::LivePosts::fetchPosts);
+    restserver->get("/api/v1/liveposts/posts", "", Rest::DbRequirement::None, Routes::LivePosts::fetchPosts); // pool only on a cache miss
     // User auth req. Create user at liveposts service for the actual logged in user.
     restserver->put("/api/v1/liveposts/posts", "*", Rest::DbRequirement::Required, Routes::LivePosts::createPost);
     restserver->put("/api/v1/liveposts/moderate", "*", Rest::DbRequirement::None, Routes::LivePosts::moderate);
@@ -297,9 +433,11 @@ int main(int argc, char *argv[])
     // NetProcessor calls to LivePost Svc. req NetProc_user authorisation from authenticated NetProc user
     //  restserver->get("/api/v1/liveposts/stage/post", "netproc", Routes::LivePosts::allocatePost); IF using stream we can use the msg fields
     restserver->put("/api/v1/liveposts/stage/post", "netproc", Rest::DbRequirement::Required, Routes::LivePosts::stagePost);
+    // Status of a stage made with ?async=true (202 Accepted with a stage job id)
+    restserver->get("/api/v1/liveposts/stage/job/{id}", "netproc", Rest::DbRequirement::None, Routes::LivePosts::stageJob);
 
     restserver->put("/api/v1/liveposts/users", "*", Rest::DbRequirement::Required, Routes::LivePosts::createAuthor); // this should only be server side done
-    restserver->get("/api/v1/liveposts/user/fetchbyauthid/{authId}", "*", Rest::DbRequirement::Required, Routes::LivePosts::fetchAuthor);
+    restserver->get("/api/v1/liveposts/user/fetchbyauthid/{authId}", "*", Rest::DbRequirement::None, Routes::LivePosts::fetchAuthor); // pool only on a cache miss
     //     restserver->get("/api/v1/liveposts/user/fetchbyid/{id}", "*", Routes::LivePosts::findUserById);
 
     // Begin the rest server at tcp address/port ioc context in a thread pool (no. of threads in cmd arg)
@@ -341,6 +479,11 @@ int main(int argc, char *argv[])
     for (auto &t : v)
       t.join();
 
+    Routes::stopResponseCompression();
+    Prerender::stopPipeline();
+    Prerender::stopPrecompress();
+    Prerender::stopWorkerPool();
+
     std::cerr << "Api server stopped.\n";
   }
   catch (const std::exception &e)
@@ -0,0 +1,153 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <fmt/format.h>
+
+namespace Metrics
+{
+
+  static std::string renderLabels(const Labels &labels)
+  {
+    std::string out;
+    for (const auto &[key, value] : labels)
+    {
+      if (!out.empty())
+        out += ',';
+      out += key;
+      out += "=\"";
+      for (char c : value)
+      {
+        if (c == '\\' || c == '"')
+          out += '\\';
+        if (c == '\n')
+        {
+          out += "\\n";
+          continue;
+        }
+        out += c;
+      }
+      out += '"';
+    }
+    return out;
+  }
+
+  // name{labels} or name{labels,extra}
+  static std::string series(const std::string &name, const std::string &labels, const std::string &extra = "")
+  {
+    std::string all = labels;
+    if (!extra.empty())
+      all += (all.empty() ? "" : ",") + extra;
+    return all.empty() ? name : name + "{" + all + "}";
+  }
+
+  Histogram::Histogram(std::vector<double> bounds)
+      : bounds_(std::move(bounds)),
+        buckets_(std::make_unique<std::atomic<std::uint64_t>[]>(bounds_.size() + 1))
+  {
+    std::sort(bounds_.begin(), bounds_.end());
+  }
+
+  void Histogram::observe(double value)
+  {
+    auto bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::vector<std::uint64_t> Histogram::cumulative() const
+  {
+    std::vector<std::uint64_t> counts(bounds_.size() + 1);
+    std::uint64_t running = 0;
+    for (std::size_t i = 0; i < counts.size(); i++)
+    {
+      running += buckets_[i].load(std::memory_order_relaxed);
+      counts[i] = running;
+    }
+    return counts;
+  }
+
+  const std::vector<double> &latencyBucketsMs()
+  {
+    static const std::vector<double> bounds = {1, 2.5, 5, 10, 25, 50, 100, 250, 500,
+                                               1000, 2500, 5000, 10000, 30000};
+    return bounds;
+  }
+
+  Counter &Registry::counter(const std::string &name, const std::string &help, const Labels &labels)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &family = counters_[name];
+    family.help = help;
+    auto &metric = family.series[renderLabels(labels)];
+    if (!metric)
+      metric = std::make_unique<Counter>();
+    return *metric;
+  }
+
+  Gauge &Registry::gauge(const std::string &name, const std::string &help, const Labels &labels)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &family = gauges_[name];
+    family.help = help;
+    auto &metric = family.series[renderLabels(labels)];
+    if (!metric)
+      metric = std::make_unique<Gauge>();
+    return *metric;
+  }
+
+  Histogram &Registry::histogram(const std::string &name, const std::string &help, const Labels &labels,
+                                 const std::vector<double> &bounds)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &family = histograms_[name];
+    family.help = help;
+    auto &metric = family.series[renderLabels(labels)];
+    if (!metric)
+      metric = std::make_unique<Histogram>(bounds);
+    return *metric;
+  }
+
+  std::string Registry::render() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+
+    for (const auto &[name, family] : counters_)
+    {
+      out += fmt::format("# HELP {} {}\n# TYPE {} counter\n", name, family.help, name);
+      for (const auto &[labels, metric] : family.series)
+        out += fmt::format("{} {}\n", series(name, labels), metric->value());
+    }
+
+    for (const auto &[name, family] : gauges_)
+    {
+      out += fmt::format("# HELP {} {}\n# TYPE {} gauge\n", name, family.help, name);
+      for (const auto &[labels, metric] : family.series)
+        out += fmt::format("{} {}\n", series(name, labels), metric->value());
+    }
+
+    for (const auto &[name, family] : histograms_)
+    {
+      out += fmt::format("# HELP {} {}\n# TYPE {} histogram\n", name, family.help, name);
+      for (const auto &[labels, metric] : family.series)
+      {
+        auto counts = metric->cumulative();
+        const auto &bounds = metric->bounds();
+        for (std::size_t i = 0; i < bounds.size(); i++)
+          out += fmt::format("{} {}\n", series(name + "_bucket", labels, fmt::format("le=\"{}\"", bounds[i])), counts[i]);
+        out += fmt::format("{} {}\n", series(name + "_bucket", labels, "le=\"+Inf\""), counts.back());
+        out += fmt::format("{} {}\n", series(name + "_sum", labels), metric->sum());
+        out += fmt::format("{} {}\n", series(name + "_count", labels), counts.back());
+      }
+    }
+    return out;
+  }
+
+  Registry &registry()
+  {
+    static Registry metrics;
+    return metrics;
+  }
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Metrics
+{
+
+  // {{"phase", "spawn"}, ...} rendered as phase="spawn"
+  using Labels = std::vector<std::pair<std::string, std::string>>;
+
+  class Counter
+  {
+  public:
+    void inc(std::uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<std::uint64_t> value_{0};
+  };
+
+  class Gauge
+  {
+  public:
+    void add(std::int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+    void set(std::int64_t n) { value_.store(n, std::memory_order_relaxed); }
+    std::int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<std::int64_t> value_{0};
+  };
+
+  // Fixed upper bounds, lock free observe
+  class Histogram
+  {
+  public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value);
+
+    const std::vector<double> &bounds() const { return bounds_; }
+    // Cumulative count per bound, then +Inf
+    std::vector<std::uint64_t> cumulative() const;
+    double sum() const { return sum_.load(std::memory_order_relaxed); }
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+  private:
+    std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> buckets_; // bounds_.size() + 1 for +Inf
+    std::atomic<double> sum_{0};
+    std::atomic<std::uint64_t> count_{0};
+  };
+
+  // 1ms .. 30s
+  const std::vector<double> &latencyBucketsMs();
+
+  // Returned references live as long as the registry; look them up once and keep them.
+  class Registry
+  {
+  public:
+    Counter &counter(const std::string &name, const std::string &help, const Labels &labels = {});
+    Gauge &gauge(const std::string &name, const std::string &help, const Labels &labels = {});
+    Histogram &histogram(const std::string &name, const std::string &help, const Labels &labels = {},
+                         const std::vector<double> &bounds = latencyBucketsMs());
+
+    // Prometheus text exposition format 0.0.4
+    std::string render() const;
+
+  private:
+    template <typename Metric>
+    struct Family
+    {
+      std::string help;
+      std::map<std::string, std::unique_ptr<Metric>> series; // keyed by rendered labels
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family<Counter>> counters_;
+    std::map<std::string, Family<Gauge>> gauges_;
+    std::map<std::string, Family<Histogram>> histograms_;
+  };
+
+  Registry &registry();
+
+}
@@ -0,0 +1,147 @@
+#include "Janitor.h"
+
+#include <unistd.h>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace Prerender
+{
+
+  Janitor &janitor()
+  {
+    static Janitor instance(256, std::chrono::milliseconds(5));
+    return instance;
+  }
+
+  Janitor::Janitor(std::size_t batchSize, std::chrono::milliseconds pause)
+      : batchSize_(batchSize), pause_(pause), thread_([this]
+                                                      { run(); })
+  {
+  }
+
+  Janitor::~Janitor()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+  }
+
+  void Janitor::remove(fs::path path)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(path));
+    }
+    wake_.notify_one();
+  }
+
+  static bool allDigits(std::string_view text)
+  {
+    return !text.empty() && text.find_first_not_of("0123456789") == std::string_view::npos;
+  }
+
+  std::size_t Janitor::sweep(const fs::path &dir)
+  {
+    const std::string ownPid = std::to_string(getpid());
+    std::size_t queued = 0;
+    std::error_code ec;
+    for (auto it = fs::directory_iterator(dir, ec);
+         !ec && it != fs::directory_iterator();
+         it.increment(ec))
+    {
+      // <name>.bak.<pid>.<n>, as named by atomic_folder_swap
+      std::string name = it->path().filename().string();
+      auto bak = name.rfind(".bak.");
+      if (bak == std::string::npos || bak == 0)
+        continue;
+      std::string_view suffix = std::string_view(name).substr(bak + 5);
+      auto dot = suffix.find('.');
+      if (dot == std::string_view::npos || !allDigits(suffix.substr(0, dot)) || !allDigits(suffix.substr(dot + 1)))
+        continue;
+      if (suffix.substr(0, dot) == ownPid)
+        continue; // ours, already queued or mid swap
+
+      remove(it->path());
+      queued++;
+    }
+    return queued;
+  }
+
+  void Janitor::run()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+      wake_.wait(lock, [this]
+                 { return stopping_ || !queue_.empty(); });
+      if (queue_.empty())
+        return; // stopping and drained
+
+      fs::path path = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      removeTree(path);
+      lock.lock();
+    }
+  }
+
+  void Janitor::removeTree(const fs::path &path)
+  {
+    std::error_code ec;
+    if (!fs::is_directory(fs::symlink_status(path, ec)))
+    {
+      fs::remove(path, ec);
+      return;
+    }
+
+    // Files first, then directories deepest first (reverse of pre-order)
+    std::vector<fs::path> dirs{path};
+    for (auto it = fs::recursive_directory_iterator(path, ec);
+         !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec))
+    {
+      if (it->is_directory(ec) && !it->is_symlink(ec))
+      {
+        dirs.push_back(it->path());
+        continue;
+      }
+      fs::remove(it->path(), ec);
+      removed();
+    }
+
+    for (auto dir = dirs.rbegin(); dir != dirs.rend(); ++dir)
+    {
+      fs::remove(*dir, ec);
+      removed();
+    }
+
+    // Anything the walk missed (e.g. an iterator error part way)
+    if (fs::exists(path, ec))
+    {
+      fs::remove_all(path, ec);
+    }
+  }
+
+  void Janitor::removed()
+  {
+    if (++sincePause_ < batchSize_)
+      return;
+    sincePause_ = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!stopping_)
+    {
+      wake_.wait_for(lock, pause_, [this]
+                     { return stopping_; });
+    }
+  }
+
+}
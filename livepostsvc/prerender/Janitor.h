@@ -0,0 +1,53 @@
+#ifndef PRERENDER_JANITOR_H
+#define PRERENDER_JANITOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace Prerender
+{
+    // Background thread deleting replaced post directories so remove_all never runs
+    // on a request or render thread. Deletes at most batchSize entries between pauses
+    // to bound the I/O it competes with.
+    class Janitor
+    {
+    public:
+      Janitor(std::size_t batchSize, std::chrono::milliseconds pause);
+      ~Janitor(); // drains the queue without pausing
+
+      Janitor(const Janitor &) = delete;
+      Janitor &operator=(const Janitor &) = delete;
+
+      // path must already be renamed out of the published tree
+      void remove(std::filesystem::path path);
+
+      // Queues every "<name>.bak.<pid>.<n>" entry directly in dir that another process left
+      // behind (a crash between the swap and the janitor). Returns how many were queued.
+      std::size_t sweep(const std::filesystem::path &dir);
+
+    private:
+      void run();
+      void removeTree(const std::filesystem::path &path);
+      void removed();
+
+      std::size_t batchSize_;
+      std::chrono::milliseconds pause_;
+      std::size_t sincePause_ = 0;
+
+      std::mutex mutex_;
+      std::condition_variable wake_;
+      std::deque<std::filesystem::path> queue_;
+      bool stopping_ = false;
+      std::thread thread_;
+    };
+
+    Janitor &janitor();
+
+}
+
+#endif // PRERENDER_JANITOR_H
@@ -0,0 +1,73 @@
+#include "Jobs.h"
+
+namespace Prerender
+{
+
+  JobRegistry &jobs()
+  {
+    static JobRegistry registry;
+    return registry;
+  }
+
+  std::uint64_t JobRegistry::create(int postId, const std::string &slug)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JobStatus job;
+    job.id = nextId_++;
+    job.postId = postId;
+    job.slug = slug;
+    job.queuedAt = std::chrono::system_clock::now();
+    job.queued = std::chrono::steady_clock::now();
+    jobs_.emplace(job.id, job);
+
+    // Ids are monotonic so the oldest jobs are at the front
+    while (jobs_.size() > MAX_JOBS)
+    {
+      jobs_.erase(jobs_.begin());
+    }
+    return job.id;
+  }
+
+  void JobRegistry::markRendering(std::uint64_t id)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end())
+      return;
+    it->second.state = JobState::Rendering;
+    it->second.started = std::chrono::steady_clock::now();
+  }
+
+  void JobRegistry::markSwapped(std::uint64_t id)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end())
+      return;
+    it->second.state = JobState::Swapped;
+    it->second.finished = std::chrono::steady_clock::now();
+  }
+
+  void JobRegistry::markFailed(std::uint64_t id, const std::string &error)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end())
+      return;
+    if (it->second.state == JobState::Queued)
+      it->second.started = std::chrono::steady_clock::now();
+    it->second.state = JobState::Failed;
+    it->second.error = error;
+    it->second.finished = std::chrono::steady_clock::now();
+  }
+
+  std::optional<JobStatus> JobRegistry::find(std::uint64_t id)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end())
+      return std::nullopt;
+    return it->second;
+  }
+
+}
@@ -0,0 +1,96 @@
+#ifndef PRERENDER_JOBS_H
+#define PRERENDER_JOBS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+namespace Prerender
+{
+    enum class JobState
+    {
+      Queued,
+      Rendering,
+      Swapped,
+      Failed
+    };
+
+    inline const char *toString(JobState state)
+    {
+      switch (state)
+      {
+      case JobState::Queued:
+        return "queued";
+      case JobState::Rendering:
+        return "rendering";
+      case JobState::Swapped:
+        return "swapped";
+      case JobState::Failed:
+        return "failed";
+      }
+      return "unknown";
+    }
+
+    struct JobStatus
+    {
+      std::uint64_t id = 0;
+      int postId = 0;
+      std::string slug;
+      JobState state = JobState::Queued;
+      std::string error;
+      std::chrono::system_clock::time_point queuedAt;
+      std::chrono::steady_clock::time_point queued;
+      std::chrono::steady_clock::time_point started;
+      std::chrono::steady_clock::time_point finished;
+    };
+
+    inline void to_json(json &jsonOut, JobStatus const &value)
+    {
+      using std::chrono::duration_cast;
+      using std::chrono::milliseconds;
+      auto now = std::chrono::steady_clock::now();
+      bool started = value.state != JobState::Queued;
+      bool finished = value.state == JobState::Swapped || value.state == JobState::Failed;
+
+      jsonOut["id"] = value.id;
+      jsonOut["postId"] = value.postId;
+      jsonOut["slug"] = value.slug;
+      jsonOut["state"] = toString(value.state);
+      jsonOut["error"] = value.error;
+      jsonOut["queuedAt"] = duration_cast<milliseconds>(value.queuedAt.time_since_epoch()).count();
+      jsonOut["queueMs"] = duration_cast<milliseconds>((started ? value.started : now) - value.queued).count();
+      jsonOut["renderMs"] = started ? duration_cast<milliseconds>((finished ? value.finished : now) - value.started).count() : 0;
+      jsonOut["totalMs"] = duration_cast<milliseconds>((finished ? value.finished : now) - value.queued).count();
+    }
+
+    // Status of asynchronous stage renders, looked up by the stage job route.
+    // Only the most recent MAX_JOBS are kept.
+    class JobRegistry
+    {
+    public:
+      std::uint64_t create(int postId, const std::string &slug);
+      void markRendering(std::uint64_t id);
+      void markSwapped(std::uint64_t id);
+      void markFailed(std::uint64_t id, const std::string &error);
+      std::optional<JobStatus> find(std::uint64_t id);
+
+    private:
+      std::mutex mutex_;
+      std::map<std::uint64_t, JobStatus> jobs_;
+      std::uint64_t nextId_ = 1;
+
+      static constexpr std::size_t MAX_JOBS = 10000;
+    };
+
+    JobRegistry &jobs();
+
+}
+
+#endif // PRERENDER_JOBS_H
@@ -0,0 +1,63 @@
+#include "Phases.h"
+#include "../metrics/Metrics.h"
+
+#include <fmt/format.h>
+
+namespace Prerender
+{
+
+  static constexpr std::array<const char *, PHASE_COUNT> PHASE_NAMES = {"spawn", "write", "render", "parse", "decode", "swap"};
+
+  // Series looked up once so observing stays lock free
+  struct PhaseMetrics
+  {
+    std::array<Metrics::Histogram *, PHASE_COUNT> durations;
+    std::array<Metrics::Counter *, PHASE_COUNT> failures;
+
+    PhaseMetrics()
+    {
+      auto &registry = Metrics::registry();
+      for (std::size_t i = 0; i < PHASE_COUNT; i++)
+      {
+        durations[i] = &registry.histogram("prerender_phase_duration_ms",
+                                           "Prerender time spent per phase in milliseconds",
+                                           {{"phase", PHASE_NAMES[i]}});
+        failures[i] = &registry.counter("prerender_phase_failures_total",
+                                        "Prerenders that failed in each phase",
+                                        {{"phase", PHASE_NAMES[i]}});
+      }
+    }
+  };
+
+  static PhaseMetrics &phaseMetrics()
+  {
+    static PhaseMetrics metrics;
+    return metrics;
+  }
+
+  const char *phaseName(Phase phase)
+  {
+    return PHASE_NAMES[static_cast<std::size_t>(phase)];
+  }
+
+  std::string PhaseTimings::summary() const
+  {
+    std::string out;
+    for (std::size_t i = 0; i < PHASE_COUNT; i++)
+    {
+      out += fmt::format("{}{} {:.1f}ms", i ? " " : "", PHASE_NAMES[i], ms[i]);
+    }
+    return out;
+  }
+
+  void observePhase(Phase phase, double ms)
+  {
+    phaseMetrics().durations[static_cast<std::size_t>(phase)]->observe(ms);
+  }
+
+  void countPhaseFailure(Phase phase)
+  {
+    phaseMetrics().failures[static_cast<std::size_t>(phase)]->inc();
+  }
+
+}
@@ -0,0 +1,75 @@
+#ifndef PRERENDER_PHASES_H
+#define PRERENDER_PHASES_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+namespace Prerender
+{
+    // Steps of one prerender, each timed into prerender_phase_duration_ms{phase=...}
+    enum class Phase
+    {
+      Spawn,  // fork/exec of node (one shot, or a pool worker restart)
+      Write,  // payload to the child's stdin
+      Render, // waiting on node for the reply (one shot output is parsed as it streams in)
+      Parse,  // reply text to a json value (plus the frame parse for pooled workers)
+      Decode, // json value to PrerenderResult(s)
+      Swap,   // atomic_folder_swap into the published tree
+    };
+    constexpr std::size_t PHASE_COUNT = 6;
+
+    const char *phaseName(Phase phase);
+
+    struct PhaseTimings
+    {
+      std::array<double, PHASE_COUNT> ms{};
+
+      double &operator[](Phase phase) { return ms[static_cast<std::size_t>(phase)]; }
+      // "spawn 0.0ms write 0.1ms render 812.4ms parse 0.3ms swap 1.2ms"
+      std::string summary() const;
+    };
+
+    void observePhase(Phase phase, double ms);
+    // prerender_phase_failures_total{phase=...}
+    void countPhaseFailure(Phase phase);
+
+    // Runs fn, adds its duration to timings[phase] and the phase histogram.
+    // Anything fn throws counts a failure for the phase and is rethrown unchanged.
+    template <typename Fn>
+    auto timePhase(Phase phase, PhaseTimings &timings, Fn &&fn)
+    {
+      auto start = std::chrono::steady_clock::now();
+      auto finish = [&]
+      {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        timings[phase] += ms;
+        observePhase(phase, ms);
+      };
+      try
+      {
+        if constexpr (std::is_void_v<decltype(fn())>)
+        {
+          fn();
+          finish();
+        }
+        else
+        {
+          auto result = fn();
+          finish();
+          return result;
+        }
+      }
+      catch (...)
+      {
+        finish();
+        countPhaseFailure(phase);
+        throw;
+      }
+    }
+
+}
+
+#endif // PRERENDER_PHASES_H
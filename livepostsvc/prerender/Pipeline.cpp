@@ -0,0 +1,57 @@
+#include "Pipeline.h"
+#include "RenderCache.h"
+#include <mtlog/mt_log.hpp>
+
+#include <memory>
+#include <stdexcept>
+
+namespace Prerender
+{
+
+  static std::unique_ptr<net::thread_pool> pipelinePool;
+  static std::unique_ptr<RenderQueue> renderQueue;
+
+  void startPipeline(std::size_t threads)
+  {
+    pipelinePool = std::make_unique<net::thread_pool>(threads == 0 ? 1 : threads);
+    renderQueue = std::make_unique<RenderQueue>(pipelinePool->get_executor());
+    mt_logging::logger().log({fmt::format("Prerender pipeline started with {} threads", threads == 0 ? 1 : threads),
+                              mt_logging::LogLevel::Info,
+                              true});
+  }
+
+  void stopPipeline()
+  {
+    if (pipelinePool)
+    {
+      pipelinePool->join(); // let queued renders finish
+      renderQueue.reset();
+      pipelinePool.reset();
+    }
+  }
+
+  net::thread_pool::executor_type executor()
+  {
+    if (!pipelinePool)
+    {
+      throw std::runtime_error("Prerender pipeline not started");
+    }
+    return pipelinePool->get_executor();
+  }
+
+  void submitRender(int postId, std::string jsonData, Priority priority,
+                    std::uint64_t jobId, RenderCompletion done)
+  {
+    if (!renderQueue)
+    {
+      throw std::runtime_error("Prerender pipeline not started");
+    }
+    renderQueue->submit(postId, std::move(jsonData), priority, jobId, std::move(done));
+  }
+
+  bool hasRendered(int postId)
+  {
+    return (renderQueue && renderQueue->hasRendered(postId)) || renderCache().contains(postId);
+  }
+
+}
@@ -0,0 +1,49 @@
+#ifndef PRERENDER_PIPELINE_H
+#define PRERENDER_PIPELINE_H
+
+#include "Prerender.h"
+#include "Jobs.h"
+#include "RenderQueue.h"
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace Prerender
+{
+    namespace net = boost::asio;
+
+    // Dedicated threads for blocking prerender work (pipe I/O, waitpid, folder swap)
+    // so the io_context threads keep serving HTTP while a post renders.
+    void startPipeline(std::size_t threads);
+    void stopPipeline();
+    net::thread_pool::executor_type executor();
+
+    // Queue a render of postId on the prerender executor, then post handler(error) to ex.
+    // error is empty when the post rendered and swapped.
+    // A non zero jobId is moved through rendering -> swapped/failed in jobs().
+    void submitRender(int postId, std::string jsonData, Priority priority,
+                      std::uint64_t jobId, RenderCompletion done);
+    // Rendered since startup or listed in the render manifest
+    bool hasRendered(int postId);
+
+    template <typename Executor, typename Handler>
+    void asyncPrerenderPost(int postId, std::string jsonData, Executor ex, Handler &&handler, std::uint64_t jobId = 0)
+    {
+      Priority priority = hasRendered(postId) ? Priority::Rerender : Priority::FirstPublish;
+      submitRender(postId, std::move(jsonData), priority, jobId,
+                   [ex, handler = std::forward<Handler>(handler)](const std::string &error)
+                   {
+                     net::post(ex,
+                               [handler, error]() mutable
+                               {
+                                 handler(error);
+                               });
+                   });
+    }
+
+}
+
+#endif // PRERENDER_PIPELINE_H
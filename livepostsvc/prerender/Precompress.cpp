@@ -0,0 +1,136 @@
+#include "Precompress.h"
+#include "../compress/Compress.h"
+#include <mtlog/mt_log.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <array>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+namespace net = boost::asio;
+
+namespace Prerender
+{
+
+  static std::unique_ptr<net::thread_pool> precompressPool;
+
+  static constexpr std::size_t MIN_BYTES = 256; // not worth a sibling below this
+  static constexpr int GZIP_LEVEL = 9;          // paid once per publish
+  static constexpr int BROTLI_QUALITY = 11;
+
+  static bool compressible(const fs::path &file)
+  {
+    static constexpr std::array<std::string_view, 5> extensions = {".html", ".js", ".css", ".json", ".mjs"};
+    auto ext = file.extension().string();
+    for (auto candidate : extensions)
+    {
+      if (ext == candidate)
+        return true;
+    }
+    return false;
+  }
+
+  // Write through a temp name so a reader never sees a partial sibling
+  static void writeSibling(const fs::path &file, Compress::Encoding encoding, const std::string &data)
+  {
+    fs::path sibling = file;
+    sibling += Compress::suffix(encoding);
+    fs::path tmp = sibling;
+    tmp += ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      out.write(data.data(), static_cast<std::streamsize>(data.size()));
+      if (!out)
+      {
+        throw Compress::CompressError("Failed to write " + tmp.string());
+      }
+    }
+    fs::rename(tmp, sibling);
+  }
+
+  static ino_t inode(const fs::path &file)
+  {
+    struct stat st;
+    return stat(file.c_str(), &st) == 0 ? st.st_ino : 0;
+  }
+
+  static void precompressFile(const fs::path &file)
+  {
+    ino_t original = inode(file);
+    std::ifstream in(file, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < MIN_BYTES)
+      return;
+
+    std::string gz = Compress::gzip(data, GZIP_LEVEL);
+    std::string br;
+    if (Compress::brotliAvailable())
+      br = Compress::brotli(data, BROTLI_QUALITY);
+
+    // Post restaged while compressing: its own precompress pass covers the new file
+    if (inode(file) != original)
+      return;
+
+    if (gz.size() < data.size())
+      writeSibling(file, Compress::Encoding::Gzip, gz);
+    if (!br.empty() && br.size() < data.size())
+      writeSibling(file, Compress::Encoding::Brotli, br);
+  }
+
+  void startPrecompress(std::size_t threads)
+  {
+    if (threads == 0)
+      return;
+    precompressPool = std::make_unique<net::thread_pool>(threads);
+  }
+
+  void stopPrecompress()
+  {
+    if (precompressPool)
+    {
+      precompressPool->join();
+      precompressPool.reset();
+    }
+  }
+
+  void precompressPost(const fs::path &dir)
+  {
+    if (!precompressPool)
+      return;
+
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(dir, ec);
+         !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec))
+    {
+      if (!it->is_regular_file(ec) || !compressible(it->path()))
+        continue;
+
+      // One task per file: a post's files compress in parallel across the pool
+      net::post(*precompressPool,
+                [file = it->path()]
+                {
+                  try
+                  {
+                    precompressFile(file);
+                  }
+                  catch (const std::exception &e)
+                  {
+                    // The folder may have been swapped again meanwhile; the next publish redoes it
+                    mt_logging::logger().log({fmt::format("Precompress {} failed: {}", file.string(), e.what()),
+                                              mt_logging::LogLevel::Debug,
+                                              true});
+                  }
+                });
+    }
+  }
+
+}
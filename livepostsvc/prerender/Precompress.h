@@ -0,0 +1,21 @@
+#ifndef PRERENDER_PRECOMPRESS_H
+#define PRERENDER_PRECOMPRESS_H
+
+#include <cstddef>
+#include <filesystem>
+
+namespace Prerender
+{
+    // Writes .gz (and .br when built with brotli) siblings for the HTML/JS/CSS/JSON files
+    // of a published post directory, so static requests never compress on the fly.
+    // Files are compressed in parallel on the precompress threads; a sibling is only kept
+    // when it is smaller than the original.
+    void startPrecompress(std::size_t threads); // 0 disables precompression
+    void stopPrecompress();
+
+    // Queue dir (a just swapped finalDir) for precompression, returns immediately
+    void precompressPost(const std::filesystem::path &dir);
+
+}
+
+#endif // PRERENDER_PRECOMPRESS_H
@@ -1,7 +1,22 @@
 #include "Prerender.h"
+#include "Janitor.h"
+#include "Phases.h"
+#include "Precompress.h"
+#include "Process.h"
+#include "Reaper.h"
+#include "RenderCache.h"
+#include "WorkerPool.h"
+#include "../metrics/Metrics.h"
 #include <mtlog/mt_log.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
 #include <iostream>
+#include <istream>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <filesystem>
@@ -9,15 +24,63 @@
 #include <stdexcept>
 #include <errno.h>
 #include <string>
+#include <memory>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace Prerender
 {
 
-  static const char *NODE_PATH = std::getenv("NODE_PATH");
   static const char *PRERENDER_SCRIPT = std::getenv("PRERENDER_SCRIPT");
 
+  // Unique name beside backupDir so a tree still being deleted never collides with the next swap
+  static fs::path trash_path(const fs::path &backupDir)
+  {
+    static std::atomic<std::uint64_t> counter{0};
+    fs::path trash = backupDir;
+    trash += "." + std::to_string(getpid()) + "." + std::to_string(++counter);
+    return trash;
+  }
+
+  // Rename path out of the published tree and let the janitor delete it (best effort)
+  static void retire(const fs::path &path, const fs::path &backupDir)
+  {
+    std::error_code ec;
+    fs::path trash = trash_path(backupDir);
+    fs::rename(path, trash, ec);
+    if (ec)
+    {
+      mt_logging::logger().log({fmt::format("Failed to retire {} : {}", path.string(), ec.message()),
+                                mt_logging::LogLevel::Error,
+                                true});
+      return;
+    }
+    janitor().remove(trash);
+  }
+
+  // renameat2(RENAME_EXCHANGE): both paths stay present throughout the swap
+  static bool exchange_dirs(const fs::path &a, const fs::path &b, std::error_code &ec)
+  {
+#ifdef RENAME_EXCHANGE
+    if (renameat2(AT_FDCWD, a.c_str(), AT_FDCWD, b.c_str(), RENAME_EXCHANGE) == 0)
+    {
+      return true;
+    }
+    ec = std::error_code(errno, std::generic_category());
+#else
+    ec = std::make_error_code(std::errc::function_not_supported);
+#endif
+    return false;
+  }
+
+  static bool exchange_unsupported(const std::error_code &ec)
+  {
+    return ec == std::errc::invalid_argument ||
+           ec == std::errc::function_not_supported ||
+           ec == std::errc::operation_not_supported;
+  }
+
   void atomic_folder_swap(const fs::path &stagingDir,
                           const fs::path &finalDir,
                           const fs::path &backupDir)
@@ -39,44 +102,62 @@ namespace Prerender
                                   finalDir.parent_path().string() + " : " + ec.message());
     }
 
-    // 2. Remove any previous leftover backup
+    // 2. Retire any previous leftover backup
     if (fs::exists(backupDir, ec))
     {
-      fs::remove_all(backupDir, ec); // best effort; on error we still continue
+      retire(backupDir, backupDir);
     }
 
-    // 3. If finalDir exists, move it to backupDir
-    if (fs::exists(finalDir, ec))
+    // 3. First publish: a plain rename is already atomic
+    if (!fs::exists(finalDir, ec))
     {
-      fs::rename(finalDir, backupDir, ec);
+      fs::rename(stagingDir, finalDir, ec);
       if (ec)
       {
-        throw AtomicFolderSwapError("Failed to rename finalDir to backupDir: " +
-                                    finalDir.string() + " -> " + backupDir.string() +
+        throw AtomicFolderSwapError("Failed to rename stagingDir to finalDir: " +
+                                    stagingDir.string() + " -> " + finalDir.string() +
                                     " : " + ec.message());
       }
+      return;
+    }
+
+    // 4. Exchange stagingDir <-> finalDir, the old tree ends up at stagingDir
+    if (exchange_dirs(stagingDir, finalDir, ec))
+    {
+      retire(stagingDir, backupDir);
+      return;
+    }
+    if (!exchange_unsupported(ec))
+    {
+      throw AtomicFolderSwapError("Failed to exchange stagingDir with finalDir: " +
+                                  stagingDir.string() + " <-> " + finalDir.string() +
+                                  " : " + ec.message());
+    }
+
+    // 5. Fallback when the filesystem has no RENAME_EXCHANGE: finalDir -> backup, stagingDir -> finalDir
+    fs::path backup = trash_path(backupDir);
+    ec.clear();
+    fs::rename(finalDir, backup, ec);
+    if (ec)
+    {
+      throw AtomicFolderSwapError("Failed to rename finalDir to backupDir: " +
+                                  finalDir.string() + " -> " + backup.string() +
+                                  " : " + ec.message());
     }
 
-    // 4. Rename stagingDir -> finalDir (atomic on same filesystem)
     fs::rename(stagingDir, finalDir, ec);
     if (ec)
     {
       // Try to roll back: move backup back to finalDir
       std::error_code rollbackEc;
-      if (fs::exists(backupDir, rollbackEc))
-      {
-        fs::rename(backupDir, finalDir, rollbackEc);
-      }
+      fs::rename(backup, finalDir, rollbackEc);
       throw AtomicFolderSwapError("Failed to rename stagingDir to finalDir: " +
                                   stagingDir.string() + " -> " + finalDir.string() +
                                   " : " + ec.message());
     }
 
-    // 5. Cleanup: remove backupDir (best effort)
-    if (fs::exists(backupDir, ec))
-    {
-      fs::remove_all(backupDir, ec); // ignore errors
-    }
+    // 6. Cleanup off this thread
+    janitor().remove(backup);
   }
 
   void swap_single_post(const PrerenderResult &r)
@@ -87,173 +168,248 @@ namespace Prerender
     backup += ".bak"; // /var/www/site/posts/1234.bak
 
     atomic_folder_swap(staging, final, backup);
+    precompressPost(final);
   }
 
-  bool write_all(int fd, const void *data, size_t size)
+  static std::unique_ptr<WorkerPool> workerPool;
+
+  void startWorkerPool(std::size_t workers)
   {
-    const char *buf = static_cast<const char *>(data);
-    size_t total_written = 0;
-    bool result = true;
-    while (total_written < size)
+    if (workers == 0)
     {
-      ssize_t n = write(fd, buf + total_written, size - total_written);
+      return; // fork/exec a fresh node process per prerender
+    }
+    workerPool = std::make_unique<WorkerPool>(workers);
+    mt_logging::logger().log({fmt::format("Prerender worker pool started with {} workers", workers),
+                              mt_logging::LogLevel::Info,
+                              true});
+  }
 
-      if (n == -1)
-      {
-        if (errno == EINTR)
-        {
-          continue; // retry
-        }
-        result = false;
-        throw std::runtime_error("write() failed: " + std::string(strerror(errno)));
-      }
+  void stopWorkerPool()
+  {
+    workerPool.reset();
+  }
 
-      if (n == 0)
-      {
-        result = false;
-        throw std::runtime_error("write() returned 0 (pipe closed)");
-      }
+  static std::atomic<std::int64_t> renderTimeoutMs{30000};
 
-      total_written += n;
-    }
-    return result;
+  void setRenderTimeout(std::chrono::milliseconds timeout)
+  {
+    renderTimeoutMs = timeout.count();
   }
 
-  void prerenderPost(const std::string &jsonData)
+  // Deadline for a payload holding posts pages; a batch gets the timeout once per post
+  static Deadline renderDeadline(std::size_t posts)
   {
-    int pipe_in[2];  // parent -> child
-    int pipe_out[2]; // child -> parent
+    std::int64_t timeout = renderTimeoutMs;
+    if (timeout <= 0)
+      return NO_DEADLINE;
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout * std::max<std::size_t>(posts, 1));
+  }
 
-    if (pipe(pipe_in) == -1)
-    {
-      perror("pipe_in failed");
-      return;
-    }
+  static Metrics::Gauge &inFlightGauge()
+  {
+    static Metrics::Gauge &gauge = Metrics::registry().gauge("prerender_in_flight",
+                                                             "Prerenders currently waiting on node");
+    return gauge;
+  }
 
-    if (pipe(pipe_out) == -1)
-    {
-      perror("pipe_out failed");
-      close(pipe_in[0]);
-      close(pipe_in[1]);
-      return;
-    }
+  static Metrics::Counter &timeoutCounter()
+  {
+    static Metrics::Counter &counter = Metrics::registry().counter("prerender_timeouts_total",
+                                                                   "Prerender children killed after missing their deadline");
+    return counter;
+  }
 
-    pid_t pid = fork();
-    if (pid == -1)
-    {
-      perror("fork failed");
-      close(pipe_in[0]);
-      close(pipe_in[1]);
-      close(pipe_out[0]);
-      close(pipe_out[1]);
-      return;
-    }
+  struct InFlight
+  {
+    InFlight() { inFlightGauge().add(1); }
+    ~InFlight() { inFlightGauge().add(-1); }
+  };
 
-    if (pid == 0)
+  // One shot render: a fresh node process reads the payload until EOF and writes the result
+  static json renderInChild(const std::string &payload, PhaseTimings &timings, Deadline deadline)
+  {
+    ChildPipes child = timePhase(Phase::Spawn, timings, []
+                                 {
+                                   ChildPipes spawned = spawn_node({PRERENDER_SCRIPT});
+                                   if (spawned.pid == -1)
+                                   {
+                                     throw std::string("Failed to start prerender process");
+                                   }
+                                   return spawned; });
+
+    // Hung child: drop our pipe ends and let the reaper SIGTERM/SIGKILL it
+    auto abandon = [&child]
     {
-      // -------------------------
-      // CHILD PROCESS
-      // -------------------------
+      if (child.in != -1)
+        close(child.in);
+      close(child.out);
+      reaper().terminate(child.pid);
+    };
 
-      // Close parent's ends
-      close(pipe_in[1]);
-      close(pipe_out[0]);
+    // Write full payload
+    timePhase(Phase::Write, timings, [&]
+              {
+                try
+                {
+                  write_all(child.in, payload.c_str(), payload.size(), deadline);
+                }
+                catch (const TimeoutError &)
+                {
+                  abandon();
+                  throw;
+                }
+                catch (const std::exception &e)
+                {
+                  // node may still answer with an error for the partial payload
+                  countPhaseFailure(Phase::Write);
+                  std::cerr << "Failed to write prerender payload: " << e.what() << "\n";
+                }
+
+                close(child.in); // send EOF to child
+                child.in = -1;
+              });
 
-      // Redirect stdin/stdout
-      dup2(pipe_in[0], STDIN_FILENO);
-      dup2(pipe_out[1], STDOUT_FILENO);
+    // -------------------------
+    // Parse child's output as it arrives on the pipe
+    // -------------------------
 
-      close(pipe_in[0]);
-      close(pipe_out[1]);
+    return timePhase(Phase::Render, timings, [&]
+                     {
+                       FdStreamBuf buffer(child.out, deadline);
+                       std::istream stream(&buffer);
+                       stream.exceptions(std::ios::badbit); // rethrow TimeoutError from the buffer
+
+                       // The script may write {"progress": ...} values ahead of its reply; each value
+                       // is parsed as soon as it is complete and only the reply is kept
+                       json reply;
+                       bool received = false;
+                       try
+                       {
+                         while (!received && (stream >> std::ws).peek() != std::char_traits<char>::eof())
+                         {
+                           json message;
+                           stream >> message;
+                           auto progress = message.find("progress");
+                           if (message.is_object() && message.size() == 1 && progress != message.end())
+                           {
+                             mt_logging::logger().log({fmt::format("Prerender {} progress {}", child.pid, progress->dump()),
+                                                       mt_logging::LogLevel::Debug,
+                                                       true});
+                             continue;
+                           }
+                           reply = std::move(message);
+                           received = true;
+                         }
+                       }
+                       catch (const TimeoutError &)
+                       {
+                         abandon();
+                         throw;
+                       }
+                       catch (const json::exception &e)
+                       {
+                         abandon();
+                         throw std::string(fmt::format("Invalid prerender output: {}", e.what()));
+                       }
+
+                       // Anything after the reply is not read; the reaper collects the child meanwhile
+                       close(child.out);
+                       reaper().reap(child.pid);
+
+                       if (!received)
+                       {
+                         std::cerr << "No data received from prerender process\n";
+                         throw std::string("No data received from prerender process");
+                       }
+                       return reply; });
+  }
 
-      // 🔒 Close all other inherited fds
-      for (int fd = 3; fd < 1024; fd++)
+  // Send one payload to a pooled worker (or a fresh node process) and return its parsed reply
+  static json render(const std::string &payload, PhaseTimings &timings, std::size_t posts)
+  {
+    InFlight inFlight;
+    Deadline deadline = renderDeadline(posts);
+    std::string output;
+    try
+    {
+      if (!workerPool)
       {
-        close(fd);
+        return renderInChild(payload, timings, deadline);
       }
-
-      // Prepare exec args
-      char *argv[] = {
-          const_cast<char *>("node"),
-          const_cast<char *>(PRERENDER_SCRIPT),
-          nullptr};
-
-      std::string pagefolderEnv = "PAGE_FOLDER="; // + pagefolder;
-      char *envp[] = {const_cast<char *>(pagefolderEnv.c_str()), nullptr};
-
-      execve(NODE_PATH, argv, envp);
-
-      _exit(1); // exec failed
+      output = workerPool->request(payload, timings, deadline);
     }
-
-    // -------------------------
-    // PARENT PROCESS
-    // -------------------------
-
-    close(pipe_in[0]);  // parent writes only
-    close(pipe_out[1]); // parent reads only
-
-    // Build payload
-    // std::string payload = "{\"pagefolder\":\"" + pagefolder + "\",\"pagedata\":" + jsonData + "}";
-    std::string payload = "{\"pagedata\":" + jsonData + "}";
-
-    // Write full payload
-    if (!write_all(pipe_in[1], payload.c_str(), payload.size()))
+    catch (const TimeoutError &)
     {
-      std::cerr << "Failed to write prerender payload\n";
+      timeoutCounter().inc();
+      throw std::string(fmt::format("Prerender timed out after {} ms", renderTimeoutMs * std::max<std::size_t>(posts, 1)));
     }
-
-    close(pipe_in[1]); // send EOF to child
-
-    // -------------------------
-    // Read child's output directly from pipe
-    // -------------------------
-
-    std::string output;
-    char buffer[4096];
-    ssize_t n;
-
-    while ((n = read(pipe_out[0], buffer, sizeof(buffer))) > 0)
+    catch (const WorkerError &e)
     {
-      output.append(buffer, n);
+      throw std::string(e.what());
     }
 
-    close(pipe_out[0]);
-
     if (output.empty())
     {
+      countPhaseFailure(Phase::Render);
       std::cerr << "No data received from prerender process\n";
       throw std::string("No data received from prerender process");
     }
+    return timePhase(Phase::Parse, timings, [&]
+                     { return json::parse(output); });
+  }
 
-    // Parse JSON result with serialized nholman json from_json()
-    PipeResponse<PrerenderResult> v;
-    json responseJson = json::parse(output);
-    v = response<PrerenderResult>(responseJson);
-    if (std::holds_alternative<PipeError>(v))
+  void prerenderPost(const std::string &jsonData, bool force)
+  {
+    // Skip node and the swap when the page content is what was last published
+    json post = json::parse(jsonData);
+    int postId = post.value("id", 0);
+    std::uint64_t hash = contentHash(post);
+    PrerenderResult cached;
+    if (!force && renderCache().unchanged(postId, hash, cached))
     {
-      auto error = std::get<PipeError>(v);
-      throw std::string(error.message);
+      mt_logging::logger().log({.line = fmt::format("Prerender Post {} unchanged, kept {}", postId, cached.finalDir),
+                                .level = mt_logging::LogLevel::Info,
+                                .include_thread_id = true});
+      return;
     }
 
-    PrerenderResult result = std::get<PrerenderResult>(v);
-    // Wait for child
-    int status;
-    waitpid(pid, &status, 0);
+    // Build payload
+    // std::string payload = "{\"pagefolder\":\"" + pagefolder + "\",\"pagedata\":" + jsonData + "}";
+    std::string payload = "{\"pagedata\":" + jsonData + "}";
+
+    PhaseTimings timings;
+    json responseJson = render(payload, timings, 1);
+
+    // Parse JSON result with serialized nholman json from_json()
+    PrerenderResult result = timePhase(Phase::Decode, timings, [&]
+                                       {
+                                         PipeResponse<PrerenderResult> v;
+                                         v = response<PrerenderResult>(responseJson);
+                                         if (std::holds_alternative<PipeError>(v))
+                                         {
+                                           auto error = std::get<PipeError>(v);
+                                           throw std::string(error.message);
+                                         }
+                                         return std::get<PrerenderResult>(v); });
 
     // Use result
-    swap_single_post(result);
+    timePhase(Phase::Swap, timings, [&]
+              { swap_single_post(result); });
+    renderCache().record(postId, hash, result);
     mt_logging::logger().log({.line = fmt::format("Prerender Post result:\n"
                                                   "          ok {}\n"
                                                   "        slug {}\n"
                                                   "       route {}\n"
                                                   "    finalDir {}\n"
-                                                  "  stagingDir {}",
+                                                  "  stagingDir {}\n"
+                                                  "     timings {}",
                                                   result.ok,
                                                   result.slug,
                                                   result.route,
                                                   result.finalDir,
-                                                  result.stagingDir),
+                                                  result.stagingDir,
+                                                  timings.summary()),
                               .level = mt_logging::LogLevel::Info,
                               .include_thread_id = true});
     // std::cout << "prerenderPost result: " << std::endl
@@ -265,4 +421,112 @@ namespace Prerender
     //           << std::endl;
   }
 
+  std::vector<std::vector<std::string>> makeBatches(const std::vector<std::string> &jsonPosts,
+                                                    const BatchLimits &limits)
+  {
+    std::vector<std::vector<std::string>> batches;
+    std::size_t batchBytes = 0;
+
+    for (const auto &post : jsonPosts)
+    {
+      bool full = !batches.empty() &&
+                  (batches.back().size() >= limits.maxPosts ||
+                   batchBytes + post.size() > limits.maxBytes);
+      if (batches.empty() || full)
+      {
+        batches.emplace_back();
+        batchBytes = 0;
+      }
+      // A single post larger than maxBytes still gets a batch of its own
+      batches.back().push_back(post);
+      batchBytes += post.size();
+    }
+    return batches;
+  }
+
+  std::vector<PrerenderResult> prerenderBatch(const std::vector<std::string> &jsonPosts, bool force)
+  {
+    std::vector<PrerenderResult> results(jsonPosts.size());
+    std::vector<int> postIds(jsonPosts.size());
+    std::vector<std::uint64_t> hashes(jsonPosts.size());
+    std::vector<std::size_t> toRender; // indexes into jsonPosts
+
+    for (std::size_t i = 0; i < jsonPosts.size(); i++)
+    {
+      json post = json::parse(jsonPosts[i]);
+      postIds[i] = post.value("id", 0);
+      hashes[i] = contentHash(post);
+      if (force || !renderCache().unchanged(postIds[i], hashes[i], results[i]))
+      {
+        toRender.push_back(i);
+      }
+    }
+
+    if (toRender.empty())
+    {
+      return results; // every post unchanged since it was last published
+    }
+
+    // Build payload {"batch":[pagedata, ...]}
+    std::string payload = "{\"batch\":[";
+    for (std::size_t i = 0; i < toRender.size(); i++)
+    {
+      if (i)
+        payload += ',';
+      payload += jsonPosts[toRender[i]];
+    }
+    payload += "]}";
+
+    PhaseTimings timings;
+    json responseJson = render(payload, timings, toRender.size());
+
+    // {"results":[PrerenderResult, ...]} in pagedata order, or {"error": "..."} for the whole batch
+    auto rendered = timePhase(Phase::Decode, timings, [&]
+                              {
+                                auto error = responseJson.find("error");
+                                if (error != responseJson.end())
+                                {
+                                  throw std::string(error->get<std::string>());
+                                }
+                                return responseJson.at("results").get<std::vector<PrerenderResult>>(); });
+    if (rendered.size() != toRender.size())
+    {
+      countPhaseFailure(Phase::Decode);
+      throw std::string(fmt::format("Prerender batch returned {} results for {} posts",
+                                    rendered.size(), toRender.size()));
+    }
+
+    std::size_t swapped = 0;
+    for (std::size_t i = 0; i < toRender.size(); i++)
+    {
+      std::size_t index = toRender[i];
+      PrerenderResult &result = results[index];
+      result = std::move(rendered[i]);
+      if (!result.ok)
+      {
+        continue; // per post render error is left in result.error
+      }
+
+      try
+      {
+        timePhase(Phase::Swap, timings, [&]
+                  { swap_single_post(result); });
+        renderCache().record(postIds[index], hashes[index], result);
+        swapped++;
+      }
+      catch (const AtomicFolderSwapError &e)
+      {
+        result.ok = false;
+        result.error = e.what();
+      }
+    }
+
+    mt_logging::logger().log({.line = fmt::format("Prerender batch result: {} posts, {} unchanged, {} swapped, timings {}",
+                                                  results.size(), results.size() - toRender.size(), swapped,
+                                                  timings.summary()),
+                              .level = mt_logging::LogLevel::Info,
+                              .include_thread_id = true});
+    return results;
+  }
+
 }
\ No newline at end of file
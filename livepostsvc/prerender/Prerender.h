@@ -1,9 +1,12 @@
 #ifndef PRERENDERER_H
 #define PRERENDERER_H
 
+#include <chrono>
 #include <string>
 #include <variant>
+#include <vector>
 #include <iostream>
+#include <cstddef>
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
@@ -86,7 +89,31 @@ namespace Prerender
       }
     };
     
-    void prerenderPost(const std::string& json);
+    // Size 0 keeps the fork/exec per prerender behaviour.
+    void startWorkerPool(std::size_t workers);
+    void stopWorkerPool();
+
+    // Deadline for one post's render (per post for a batch); the child is then SIGTERMed,
+    // SIGKILLed after a grace period, and the stage fails with "Prerender timed out". 0 disables.
+    void setRenderTimeout(std::chrono::milliseconds timeout);
+
+    // Throws std::string when the render fails, AtomicFolderSwapError when the swap does. force renders a post the render cache
+    // reports unchanged, and overwrites its entry.
+    void prerenderPost(const std::string& json, bool force = false);
+
+    // Batch protocol: {"batch":[pagedata, ...]} -> {"results":[PrerenderResult, ...]}
+    struct BatchLimits {
+      std::size_t maxPosts = 50;
+      std::size_t maxBytes = 4 * 1024 * 1024; // summed pagedata JSON
+    };
+
+    std::vector<std::vector<std::string>> makeBatches(const std::vector<std::string> &jsonPosts,
+                                                      const BatchLimits &limits);
+
+    // Renders every post in one node invocation and swaps each ok result.
+    // Throws std::string when the whole batch fails; per post failures come back with ok false.
+    // force renders posts the render cache reports unchanged, and overwrites their entries.
+    std::vector<PrerenderResult> prerenderBatch(const std::vector<std::string> &jsonPosts, bool force = false);
 
 }
 
@@ -0,0 +1,336 @@
+#include "Process.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// posix_spawn_file_actions_addclosefrom_np arrived in glibc 2.34
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+#define HAVE_SPAWN_CLOSEFROM 1
+#else
+#define HAVE_SPAWN_CLOSEFROM 0
+#endif
+
+namespace Prerender
+{
+
+  static const char *NODE_PATH = std::getenv("NODE_PATH");
+
+  static std::vector<char *> c_strings(const std::vector<std::string> &strings)
+  {
+    std::vector<char *> pointers;
+    for (auto &string : strings)
+      pointers.push_back(const_cast<char *>(string.c_str()));
+    pointers.push_back(nullptr);
+    return pointers;
+  }
+
+  Launcher default_launcher()
+  {
+#if HAVE_SPAWN_CLOSEFROM
+    return Launcher::PosixSpawn;
+#else
+    return Launcher::Fork;
+#endif
+  }
+
+  // glibc runs posix_spawn as clone(CLONE_VM | CLONE_VFORK): the child borrows the parent's
+  // memory until execve, so the cost no longer grows with the service's RSS.
+  static pid_t launch_posix_spawn(const char *path, char *const argv[], char *const envp[],
+                                  int childIn, int childOut)
+  {
+#if HAVE_SPAWN_CLOSEFROM
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0)
+      return -1;
+
+    pid_t pid = -1;
+    int rc = posix_spawn_file_actions_adddup2(&actions, childIn, STDIN_FILENO);
+    if (rc == 0)
+      rc = posix_spawn_file_actions_adddup2(&actions, childOut, STDOUT_FILENO);
+    // Close all other inherited fds (the pipe ends included, they are >= 3)
+    if (rc == 0)
+      rc = posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+    if (rc == 0)
+      rc = posix_spawn(&pid, path, &actions, nullptr, argv, envp);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (rc != 0)
+    {
+      errno = rc;
+      perror("posix_spawn failed");
+      return -1;
+    }
+    return pid;
+#else
+    (void)path, (void)argv, (void)envp, (void)childIn, (void)childOut;
+    errno = ENOSYS;
+    return -1;
+#endif
+  }
+
+  static pid_t launch_fork(const char *path, char *const argv[], char *const envp[],
+                           int childIn, int childOut)
+  {
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+      perror("fork failed");
+      return -1;
+    }
+
+    if (pid == 0)
+    {
+      // -------------------------
+      // CHILD PROCESS
+      // -------------------------
+
+      // Redirect stdin/stdout
+      dup2(childIn, STDIN_FILENO);
+      dup2(childOut, STDOUT_FILENO);
+
+      // 🔒 Close all other inherited fds
+#ifdef SYS_close_range
+      if (syscall(SYS_close_range, 3U, ~0U, 0U) != 0)
+#endif
+      {
+        for (int fd = 3; fd < 1024; fd++)
+        {
+          close(fd);
+        }
+      }
+
+      execve(path, argv, envp);
+
+      _exit(1); // exec failed
+    }
+    return pid;
+  }
+
+  ChildPipes spawn_child(const std::string &path,
+                         const std::vector<std::string> &argv,
+                         const std::vector<std::string> &envp,
+                         Launcher launcher)
+  {
+    ChildPipes child;
+    int pipe_in[2];  // parent -> child
+    int pipe_out[2]; // child -> parent
+
+    // O_CLOEXEC keeps the parent's ends out of children spawned concurrently on other threads
+    if (pipe2(pipe_in, O_CLOEXEC) == -1)
+    {
+      perror("pipe_in failed");
+      return child;
+    }
+
+    if (pipe2(pipe_out, O_CLOEXEC) == -1)
+    {
+      perror("pipe_out failed");
+      close(pipe_in[0]);
+      close(pipe_in[1]);
+      return child;
+    }
+
+    // Build exec args before launching so the child only calls async-signal-safe functions
+    std::vector<char *> args = c_strings(argv);
+    std::vector<char *> env = c_strings(envp);
+
+    pid_t pid = launcher == Launcher::PosixSpawn
+                    ? launch_posix_spawn(path.c_str(), args.data(), env.data(), pipe_in[0], pipe_out[1])
+                    : launch_fork(path.c_str(), args.data(), env.data(), pipe_in[0], pipe_out[1]);
+
+    // -------------------------
+    // PARENT PROCESS
+    // -------------------------
+
+    close(pipe_in[0]);  // parent writes only
+    close(pipe_out[1]); // parent reads only
+
+    if (pid == -1)
+    {
+      close(pipe_in[1]);
+      close(pipe_out[0]);
+      return child;
+    }
+
+    child.pid = pid;
+    child.in = pipe_in[1];
+    child.out = pipe_out[0];
+    return child;
+  }
+
+  ChildPipes spawn_node(const std::vector<std::string> &args)
+  {
+    std::vector<std::string> argv = {"node"};
+    argv.insert(argv.end(), args.begin(), args.end());
+    return spawn_child(NODE_PATH ? NODE_PATH : "", argv, {"PAGE_FOLDER="}, default_launcher());
+  }
+
+  // Blocks in poll() until fd is ready for events; throws TimeoutError past deadline
+  static void wait_ready(int fd, short events, Deadline deadline)
+  {
+    if (deadline == NO_DEADLINE)
+      return;
+
+    while (true)
+    {
+      auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0)
+      {
+        throw TimeoutError("Prerender child did not respond before its deadline");
+      }
+
+      pollfd pfd{fd, events, 0};
+      int n = poll(&pfd, 1, static_cast<int>(std::min<std::int64_t>(left.count(), 60 * 1000)));
+      if (n == -1 && errno != EINTR)
+      {
+        throw std::runtime_error("poll() failed: " + std::string(strerror(errno)));
+      }
+      if (n > 0)
+        return; // ready, or POLLHUP/POLLERR which the read/write reports
+    }
+  }
+
+  bool write_all(int fd, const void *data, size_t size, Deadline deadline)
+  {
+    const char *buf = static_cast<const char *>(data);
+    size_t total_written = 0;
+    bool result = true;
+    while (total_written < size)
+    {
+      wait_ready(fd, POLLOUT, deadline);
+      // POLLOUT only promises PIPE_BUF bytes, a larger blocking write could stall past the deadline
+      size_t chunk = size - total_written;
+      if (deadline != NO_DEADLINE)
+        chunk = std::min<size_t>(chunk, PIPE_BUF);
+      ssize_t n = write(fd, buf + total_written, chunk);
+
+      if (n == -1)
+      {
+        if (errno == EINTR)
+        {
+          continue; // retry
+        }
+        result = false;
+        throw std::runtime_error("write() failed: " + std::string(strerror(errno)));
+      }
+
+      if (n == 0)
+      {
+        result = false;
+        throw std::runtime_error("write() returned 0 (pipe closed)");
+      }
+
+      total_written += n;
+    }
+    return result;
+  }
+
+  bool read_exact(int fd, void *data, size_t size, Deadline deadline)
+  {
+    char *buf = static_cast<char *>(data);
+    size_t total_read = 0;
+    while (total_read < size)
+    {
+      wait_ready(fd, POLLIN, deadline);
+      ssize_t n = read(fd, buf + total_read, size - total_read);
+
+      if (n == -1)
+      {
+        if (errno == EINTR)
+        {
+          continue; // retry
+        }
+        throw std::runtime_error("read() failed: " + std::string(strerror(errno)));
+      }
+
+      if (n == 0)
+      {
+        return false; // EOF
+      }
+
+      total_read += n;
+    }
+    return true;
+  }
+
+  std::size_t read_some(int fd, void *data, size_t size, Deadline deadline)
+  {
+    while (true)
+    {
+      wait_ready(fd, POLLIN, deadline);
+      ssize_t n = read(fd, data, size);
+      if (n == -1)
+      {
+        if (errno == EINTR)
+        {
+          continue; // retry
+        }
+        throw std::runtime_error("read() failed: " + std::string(strerror(errno)));
+      }
+      return static_cast<std::size_t>(n);
+    }
+  }
+
+  FdStreamBuf::int_type FdStreamBuf::underflow()
+  {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+
+    std::size_t n = read_some(fd_, buffer_, sizeof(buffer_), deadline_);
+    if (n == 0)
+      return traits_type::eof();
+    setg(buffer_, buffer_, buffer_ + n);
+    return traits_type::to_int_type(*gptr());
+  }
+
+  void write_frame(int fd, const std::string &payload, Deadline deadline)
+  {
+    auto size = static_cast<std::uint32_t>(payload.size());
+    unsigned char header[4] = {
+        static_cast<unsigned char>(size >> 24),
+        static_cast<unsigned char>(size >> 16),
+        static_cast<unsigned char>(size >> 8),
+        static_cast<unsigned char>(size)};
+
+    write_all(fd, header, sizeof(header), deadline);
+    write_all(fd, payload.data(), payload.size(), deadline);
+  }
+
+  bool read_frame(int fd, std::string &payload, std::size_t maxBytes, Deadline deadline)
+  {
+    unsigned char header[4];
+    if (!read_exact(fd, header, sizeof(header), deadline))
+    {
+      return false;
+    }
+
+    std::uint32_t size = (std::uint32_t(header[0]) << 24) |
+                         (std::uint32_t(header[1]) << 16) |
+                         (std::uint32_t(header[2]) << 8) |
+                         std::uint32_t(header[3]);
+    if (size > maxBytes)
+    {
+      throw std::runtime_error("Prerender frame too large: " + std::to_string(size) + " bytes");
+    }
+
+    payload.resize(size);
+    if (!read_exact(fd, payload.data(), size, deadline))
+    {
+      throw std::runtime_error("Prerender frame truncated (worker closed stdout)");
+    }
+    return true;
+  }
+
+}
@@ -0,0 +1,81 @@
+#ifndef PRERENDER_PROCESS_H
+#define PRERENDER_PROCESS_H
+
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace Prerender
+{
+    // Child process with stdin/stdout connected to pipes held by the parent.
+    struct ChildPipes
+    {
+      pid_t pid = -1;
+      int in = -1;  // parent writes
+      int out = -1; // parent reads
+    };
+
+    enum class Launcher
+    {
+      PosixSpawn, // vfork style clone: no copy of the parent's page tables
+      Fork,       // fork + execve, fds closed with close_range (or a close loop)
+    };
+
+    // PosixSpawn when libc can close inherited fds in the file actions, otherwise Fork
+    Launcher default_launcher();
+
+    // Start path with argv (argv[0] included) and envp, stdin/stdout on pipes, stderr inherited
+    // and every other fd closed. Returns pid -1 (and no fds) on failure.
+    ChildPipes spawn_child(const std::string &path,
+                           const std::vector<std::string> &argv,
+                           const std::vector<std::string> &envp,
+                           Launcher launcher);
+
+    // Start NODE_PATH with args (argv[1..]) using default_launcher().
+    ChildPipes spawn_node(const std::vector<std::string> &args);
+
+    // Pipe I/O past its deadline; the caller owns killing the child
+    class TimeoutError : public std::runtime_error {
+      public:
+      using std::runtime_error::runtime_error;
+    };
+
+    // Deadline::max() blocks as before
+    using Deadline = std::chrono::steady_clock::time_point;
+    constexpr Deadline NO_DEADLINE = Deadline::max();
+
+    bool write_all(int fd, const void *data, size_t size, Deadline deadline = NO_DEADLINE);
+
+    // Reads exactly size bytes. Returns false on EOF before size bytes arrive.
+    bool read_exact(int fd, void *data, size_t size, Deadline deadline = NO_DEADLINE);
+
+    // One read() once fd is readable. Returns 0 on EOF.
+    std::size_t read_some(int fd, void *data, size_t size, Deadline deadline = NO_DEADLINE);
+
+    // Read only istream source over a child's stdout, refilled as output arrives, so a
+    // parser can consume the stream while the child is still writing. Does not own fd.
+    class FdStreamBuf : public std::streambuf
+    {
+    public:
+      FdStreamBuf(int fd, Deadline deadline) : fd_(fd), deadline_(deadline) {}
+
+    protected:
+      int_type underflow() override;
+
+    private:
+      int fd_;
+      Deadline deadline_;
+      char buffer_[4096];
+    };
+
+    void write_frame(int fd, const std::string &payload, Deadline deadline = NO_DEADLINE);
+    // Returns false on a clean EOF at a frame boundary.
+    bool read_frame(int fd, std::string &payload, std::size_t maxBytes, Deadline deadline = NO_DEADLINE);
+
+}
+
+#endif // PRERENDER_PROCESS_H
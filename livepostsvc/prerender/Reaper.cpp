@@ -0,0 +1,111 @@
+#include "Reaper.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <utility>
+
+namespace Prerender
+{
+
+  Reaper &reaper()
+  {
+    static Reaper instance(std::chrono::seconds(2));
+    return instance;
+  }
+
+  Reaper::Reaper(std::chrono::milliseconds grace)
+      : grace_(grace), thread_([this]
+                               { run(); })
+  {
+  }
+
+  Reaper::~Reaper()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+  }
+
+  void Reaper::reap(pid_t pid)
+  {
+    auto now = Clock::now();
+    add({pid, now + grace_, now + 2 * grace_});
+  }
+
+  void Reaper::terminate(pid_t pid)
+  {
+    if (pid <= 0)
+      return; // kill(-1) would signal every process we may signal
+    kill(pid, SIGTERM);
+    add({pid, Clock::now(), Clock::now() + grace_, true});
+  }
+
+  std::size_t Reaper::pending()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return children_.size();
+  }
+
+  void Reaper::add(Child child)
+  {
+    if (child.pid <= 0)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      children_.push_back(std::move(child));
+    }
+    wake_.notify_one();
+  }
+
+  void Reaper::run()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+      if (children_.empty())
+      {
+        wake_.wait(lock, [this]
+                   { return stopping_ || !children_.empty(); });
+      }
+      else if (!stopping_)
+      {
+        wake_.wait_for(lock, POLL, [this]
+                       { return stopping_; });
+      }
+
+      auto now = Clock::now();
+      for (auto it = children_.begin(); it != children_.end();)
+      {
+        int status;
+        pid_t rc = waitpid(it->pid, &status, WNOHANG);
+        if (rc == it->pid || (rc == -1 && errno == ECHILD))
+        {
+          it = children_.erase(it);
+          continue;
+        }
+
+        if (stopping_ || now >= it->killAt)
+        {
+          kill(it->pid, SIGKILL);
+          waitpid(it->pid, &status, 0); // SIGKILL cannot be ignored
+          it = children_.erase(it);
+          continue;
+        }
+        if (!it->termSent && now >= it->termAt)
+        {
+          kill(it->pid, SIGTERM);
+          it->termSent = true;
+        }
+        ++it;
+      }
+
+      if (stopping_ && children_.empty())
+        return;
+    }
+  }
+
+}
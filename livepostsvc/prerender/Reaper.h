@@ -0,0 +1,60 @@
+#ifndef PRERENDER_REAPER_H
+#define PRERENDER_REAPER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+namespace Prerender
+{
+    // Background thread collecting prerender children so no render thread blocks in waitpid().
+    // A child still running after its grace period gets SIGTERM, then SIGKILL one grace later.
+    class Reaper
+    {
+    public:
+      explicit Reaper(std::chrono::milliseconds grace);
+      ~Reaper(); // SIGKILLs and reaps whatever is left
+
+      Reaper(const Reaper &) = delete;
+      Reaper &operator=(const Reaper &) = delete;
+
+      // Child expected to exit by itself (its stdout already hit EOF)
+      void reap(pid_t pid);
+      // Child that missed its deadline: SIGTERM now
+      void terminate(pid_t pid);
+
+      std::size_t pending();
+
+    private:
+      using Clock = std::chrono::steady_clock;
+
+      struct Child
+      {
+        pid_t pid;
+        Clock::time_point termAt;
+        Clock::time_point killAt;
+        bool termSent = false;
+      };
+
+      void add(Child child);
+      void run();
+
+      std::chrono::milliseconds grace_;
+      std::mutex mutex_;
+      std::condition_variable wake_;
+      std::vector<Child> children_;
+      bool stopping_ = false;
+      std::thread thread_;
+
+      static constexpr std::chrono::milliseconds POLL{20};
+    };
+
+    Reaper &reaper();
+
+}
+
+#endif // PRERENDER_REAPER_H
@@ -0,0 +1,177 @@
+#include "RenderCache.h"
+#include "Janitor.h"
+#include <mtlog/mt_log.hpp>
+
+#include <charconv>
+#include <fstream>
+#include <set>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace Prerender
+{
+
+  std::uint64_t contentHash(const json &post)
+  {
+    // json objects keep keys sorted so the dump is canonical
+    json canonical;
+    canonical["title"] = post.value("title", "");
+    canonical["content"] = post.value("content", "");
+    canonical["slug"] = post.value("slug", "");
+    canonical["userName"] = post.value("userName", "");
+    canonical["live"] = post.value("live", false);
+    std::string text = canonical.dump();
+
+    // FNV-1a 64
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text)
+    {
+      hash ^= c;
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
+  RenderCache &renderCache()
+  {
+    static RenderCache cache;
+    return cache;
+  }
+
+  void RenderCache::load(const fs::path &siteRoot)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fs::path root = siteRoot.lexically_normal();
+    if (!root.has_filename())
+      root = root.parent_path(); // "latest/" -> "latest"
+    manifest_ = root;
+    manifest_ += ".prerender-manifest";
+    entries_.clear();
+
+    std::ifstream in(manifest_);
+    std::size_t lines = 0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+      // id \t hash(hex) \t slug \t route \t finalDir
+      std::vector<std::string_view> fields;
+      std::string_view rest(line);
+      for (std::size_t tab; (tab = rest.find('\t')) != std::string_view::npos;)
+      {
+        fields.push_back(rest.substr(0, tab));
+        rest.remove_prefix(tab + 1);
+      }
+      fields.push_back(rest);
+      if (fields.size() != 5)
+        continue;
+
+      int postId = 0;
+      Entry entry;
+      auto id = std::from_chars(fields[0].data(), fields[0].data() + fields[0].size(), postId);
+      auto hash = std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), entry.hash, 16);
+      if (id.ec != std::errc() || hash.ec != std::errc())
+        continue;
+
+      entry.result.ok = true;
+      entry.result.slug = fields[2];
+      entry.result.route = fields[3];
+      entry.result.finalDir = fields[4];
+      entries_[postId] = std::move(entry);
+      lines++;
+    }
+
+    if (lines > entries_.size())
+    {
+      compact();
+    }
+
+    mt_logging::logger().log({fmt::format("Prerender manifest {} loaded {} posts", manifest_.string(), entries_.size()),
+                              mt_logging::LogLevel::Info,
+                              true});
+
+    // Backups a crash left next to published post folders
+    std::set<fs::path> parents{root};
+    for (const auto &[postId, entry] : entries_)
+      parents.insert(fs::path(entry.result.finalDir).parent_path());
+    std::size_t swept = 0;
+    for (const auto &dir : parents)
+      swept += janitor().sweep(dir);
+    if (swept > 0)
+    {
+      mt_logging::logger().log({fmt::format("Prerender startup handed {} leftover backup folders to the janitor", swept),
+                                mt_logging::LogLevel::Info,
+                                true});
+    }
+  }
+
+  bool RenderCache::unchanged(int postId, std::uint64_t hash, PrerenderResult &cached)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (manifest_.empty())
+      return false;
+
+    auto it = entries_.find(postId);
+    if (it == entries_.end() || it->second.hash != hash)
+      return false;
+
+    std::error_code ec;
+    if (!fs::is_directory(it->second.result.finalDir, ec))
+      return false; // published folder went missing, render it again
+
+    cached = it->second.result;
+    return true;
+  }
+
+  void RenderCache::record(int postId, std::uint64_t hash, const PrerenderResult &result)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (manifest_.empty())
+      return;
+
+    Entry &entry = entries_[postId];
+    entry.hash = hash;
+    entry.result = result;
+    append(postId, entry);
+  }
+
+  bool RenderCache::contains(int postId)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.contains(postId);
+  }
+
+  void RenderCache::append(int postId, const Entry &entry)
+  {
+    std::ofstream out(manifest_, std::ios::app);
+    out << postId << '\t' << std::hex << entry.hash << std::dec << '\t'
+        << entry.result.slug << '\t' << entry.result.route << '\t' << entry.result.finalDir << '\n';
+    if (!out)
+    {
+      mt_logging::logger().log({"Prerender manifest append failed: " + manifest_.string(),
+                                mt_logging::LogLevel::Error,
+                                true});
+    }
+  }
+
+  void RenderCache::compact()
+  {
+    fs::path tmp = manifest_;
+    tmp += ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::trunc);
+      for (const auto &[postId, entry] : entries_)
+      {
+        out << postId << '\t' << std::hex << entry.hash << std::dec << '\t'
+            << entry.result.slug << '\t' << entry.result.route << '\t' << entry.result.finalDir << '\n';
+      }
+      if (!out)
+        return;
+    }
+    std::error_code ec;
+    fs::rename(tmp, manifest_, ec);
+  }
+
+}
@@ -0,0 +1,51 @@
+#ifndef PRERENDER_RENDERCACHE_H
+#define PRERENDER_RENDERCACHE_H
+
+#include "Prerender.h"
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Prerender
+{
+    // Hash of the fields that change the rendered page (title, content, slug, userName, live).
+    // Reaction counters and other columns are left out so they never force a render.
+    std::uint64_t contentHash(const json &post);
+
+    // Post id -> content hash of the last successful render, persisted as an append only
+    // manifest next to the site root ("<root>.prerender-manifest"). Later lines override earlier
+    // ones; the file is compacted on load.
+    class RenderCache
+    {
+    public:
+      // Disabled until loaded. Also sweeps leftover "<post>.bak.<pid>.<n>" folders directly under
+      // the site root and beside the recorded post folders to the janitor.
+      void load(const std::filesystem::path &siteRoot);
+
+      // True (and cached filled) when postId last rendered with hash and its finalDir still exists
+      bool unchanged(int postId, std::uint64_t hash, PrerenderResult &cached);
+      void record(int postId, std::uint64_t hash, const PrerenderResult &result);
+      bool contains(int postId);
+
+    private:
+      struct Entry
+      {
+        std::uint64_t hash = 0;
+        PrerenderResult result;
+      };
+
+      void append(int postId, const Entry &entry); // requires mutex_
+      void compact();                              // requires mutex_
+
+      std::mutex mutex_;
+      std::filesystem::path manifest_;
+      std::unordered_map<int, Entry> entries_;
+    };
+
+    RenderCache &renderCache();
+
+}
+
+#endif // PRERENDER_RENDERCACHE_H
@@ -0,0 +1,146 @@
+#include "RenderQueue.h"
+#include "Prerender.h"
+#include "Jobs.h"
+#include <mtlog/mt_log.hpp>
+
+#include <boost/asio/post.hpp>
+#include <exception>
+#include <utility>
+
+namespace Prerender
+{
+
+  RenderQueue::RenderQueue(net::thread_pool::executor_type executor)
+      : executor_(executor)
+  {
+  }
+
+  void RenderQueue::submit(int postId, std::string jsonData, Priority priority,
+                           std::uint64_t jobId, RenderCompletion done)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = pending_.try_emplace(postId);
+    Entry &entry = it->second;
+
+    if (!inserted)
+    {
+      mt_logging::logger().log({fmt::format("Prerender post {} coalesced with a pending render", postId),
+                                mt_logging::LogLevel::Debug,
+                                true});
+    }
+
+    entry.jsonData = std::move(jsonData); // latest wins
+    if (jobId)
+      entry.jobIds.push_back(jobId);
+    entry.completions.push_back(std::move(done));
+
+    bool upgrade = priority == Priority::FirstPublish && entry.priority == Priority::Rerender;
+    if (inserted || upgrade)
+    {
+      entry.priority = priority;
+      if (!running_.contains(postId))
+      {
+        enqueue(postId, entry);
+      }
+      // else: picked up as the single follow up when the running render finishes
+    }
+  }
+
+  bool RenderQueue::hasRendered(int postId)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rendered_.contains(postId);
+  }
+
+  void RenderQueue::enqueue(int postId, Entry &entry)
+  {
+    entry.queued = true;
+    if (entry.priority == Priority::FirstPublish)
+      firstPublish_.push_back(postId);
+    else
+      rerender_.push_back(postId);
+
+    // One drain task per lane push; stale lane entries are skipped in runNext
+    net::post(executor_, [this]
+              { runNext(); });
+  }
+
+  void RenderQueue::runNext()
+  {
+    int postId = 0;
+    Entry entry;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      auto take = [this, &postId, &entry](std::deque<int> &lane, Priority priority)
+      {
+        while (!lane.empty())
+        {
+          int id = lane.front();
+          lane.pop_front();
+          auto it = pending_.find(id);
+          if (it == pending_.end() || !it->second.queued || it->second.priority != priority ||
+              running_.contains(id))
+          {
+            continue; // stale: taken from the other lane or already running
+          }
+          postId = id;
+          entry = std::move(it->second);
+          pending_.erase(it);
+          running_.insert(id);
+          return true;
+        }
+        return false;
+      };
+
+      if (!take(firstPublish_, Priority::FirstPublish) &&
+          !take(rerender_, Priority::Rerender))
+      {
+        return;
+      }
+    }
+
+    for (auto jobId : entry.jobIds)
+      jobs().markRendering(jobId);
+
+    std::string error;
+    try
+    {
+      prerenderPost(entry.jsonData);
+    }
+    catch (const std::string &e)
+    {
+      error = e;
+    }
+    catch (const std::exception &e)
+    {
+      error = e.what();
+    }
+
+    for (auto jobId : entry.jobIds)
+    {
+      if (error.empty())
+        jobs().markSwapped(jobId);
+      else
+        jobs().markFailed(jobId, error);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_.erase(postId);
+      if (error.empty())
+        rendered_.insert(postId);
+
+      // Restaged while rendering: one follow up render with the newest payload
+      auto it = pending_.find(postId);
+      if (it != pending_.end() && !it->second.queued)
+      {
+        enqueue(postId, it->second);
+      }
+    }
+
+    for (auto &done : entry.completions)
+      done(error);
+  }
+
+}
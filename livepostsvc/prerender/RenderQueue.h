@@ -0,0 +1,66 @@
+#ifndef PRERENDER_RENDERQUEUE_H
+#define PRERENDER_RENDERQUEUE_H
+
+#include <boost/asio/thread_pool.hpp>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Prerender
+{
+    namespace net = boost::asio;
+
+    enum class Priority
+    {
+      FirstPublish, // never rendered, goes ahead of re-renders
+      Rerender
+    };
+
+    // Called once per submit with an empty error when the render and swap succeeded.
+    using RenderCompletion = std::function<void(const std::string &error)>;
+
+    // Prerender jobs keyed by post id, latest payload wins.
+    //  - A post already waiting has its payload replaced; every submitter gets the one result.
+    //  - A post already rendering gets at most one follow up render with the newest payload.
+    //  - FirstPublish posts are taken before Rerender posts.
+    class RenderQueue
+    {
+    public:
+      explicit RenderQueue(net::thread_pool::executor_type executor);
+
+      void submit(int postId, std::string jsonData, Priority priority,
+                  std::uint64_t jobId, RenderCompletion done);
+
+      // Post rendered successfully since startup
+      bool hasRendered(int postId);
+
+    private:
+      struct Entry
+      {
+        std::string jsonData;
+        Priority priority = Priority::Rerender;
+        bool queued = false; // in a lane (false while waiting on a running render)
+        std::vector<std::uint64_t> jobIds;
+        std::vector<RenderCompletion> completions;
+      };
+
+      void enqueue(int postId, Entry &entry); // requires mutex_
+      void runNext();
+
+      net::thread_pool::executor_type executor_;
+      std::mutex mutex_;
+      std::unordered_map<int, Entry> pending_;
+      std::deque<int> firstPublish_;
+      std::deque<int> rerender_;
+      std::unordered_set<int> running_;
+      std::unordered_set<int> rendered_;
+    };
+
+}
+
+#endif // PRERENDER_RENDERQUEUE_H
@@ -0,0 +1,186 @@
+#include "WorkerPool.h"
+#include "Process.h"
+#include "Reaper.h"
+#include <mtlog/mt_log.hpp>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <thread>
+
+namespace Prerender
+{
+
+  static const char *PRERENDER_SCRIPT = std::getenv("PRERENDER_SCRIPT");
+
+  WorkerPool::WorkerPool(std::size_t size)
+      : workers_(size)
+  {
+    // SIGPIPE is ignored at startup in main(), so a worker dying mid write surfaces as EPIPE
+    for (std::size_t i = 0; i < workers_.size(); i++)
+    {
+      spawn(workers_[i]);
+      free_.push_back(i);
+    }
+  }
+
+  WorkerPool::~WorkerPool()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_ = true;
+    idle_.notify_all();
+    // Wait for in flight jobs to hand their worker back
+    idle_.wait(lock, [this]
+               { return free_.size() == workers_.size(); });
+    // EOF to every worker first so they all exit in parallel within one grace period
+    for (auto &worker : workers_)
+    {
+      closeFds(worker);
+    }
+    Deadline deadline = std::chrono::steady_clock::now() + STOP_GRACE;
+    for (auto &worker : workers_)
+    {
+      stop(worker, deadline);
+    }
+  }
+
+  std::string WorkerPool::request(const std::string &payload, PhaseTimings &timings, Deadline deadline)
+  {
+    std::size_t index = acquire();
+    WorkerProcess &worker = workers_[index];
+
+    try
+    {
+      if (worker.pid == -1)
+      {
+        // Previous restart failed to spawn, try again now
+        timePhase(Phase::Spawn, timings, [&]
+                  {
+                    spawn(worker);
+                    if (worker.pid == -1)
+                    {
+                      throw WorkerError("Prerender worker could not be started");
+                    } });
+      }
+
+      timePhase(Phase::Write, timings, [&]
+                { write_frame(worker.in, payload, deadline); });
+
+      std::string reply;
+      timePhase(Phase::Render, timings, [&]
+                {
+                  if (!read_frame(worker.out, reply, MAX_FRAME_BYTES, deadline))
+                  {
+                    throw WorkerError("Prerender worker exited before replying");
+                  } });
+
+      release(index);
+      return reply;
+    }
+    catch (const TimeoutError &)
+    {
+      mt_logging::logger().log({fmt::format("Prerender worker {} timed out, restarting", worker.pid),
+                                mt_logging::LogLevel::Error,
+                                true});
+      restart(index);
+      release(index);
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      mt_logging::logger().log({fmt::format("Prerender worker {} failed, restarting: {}", worker.pid, e.what()),
+                                mt_logging::LogLevel::Error,
+                                true});
+      restart(index);
+      release(index);
+      throw WorkerError(e.what());
+    }
+  }
+
+  std::size_t WorkerPool::acquire()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]
+               { return !free_.empty() || stopping_; });
+    if (free_.empty())
+    {
+      throw WorkerError("Prerender worker pool is stopping");
+    }
+    std::size_t index = free_.back();
+    free_.pop_back();
+    return index;
+  }
+
+  void WorkerPool::release(std::size_t index)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_.push_back(index);
+    }
+    idle_.notify_all();
+  }
+
+  void WorkerPool::spawn(WorkerProcess &worker)
+  {
+    ChildPipes child = spawn_node({PRERENDER_SCRIPT, "--server"});
+    worker.pid = child.pid;
+    worker.in = child.in;
+    worker.out = child.out;
+
+    if (worker.pid == -1)
+    {
+      mt_logging::logger().log({"Prerender worker spawn failed",
+                                mt_logging::LogLevel::Error,
+                                true});
+    }
+  }
+
+  void WorkerPool::closeFds(WorkerProcess &worker)
+  {
+    if (worker.in != -1)
+      close(worker.in); // EOF on stdin asks a healthy worker to exit
+    if (worker.out != -1)
+      close(worker.out);
+    worker.in = -1;
+    worker.out = -1;
+  }
+
+  void WorkerPool::stop(WorkerProcess &worker, Deadline deadline)
+  {
+    closeFds(worker);
+
+    if (worker.pid != -1)
+    {
+      int status;
+      while (waitpid(worker.pid, &status, WNOHANG) == 0)
+      {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+          kill(worker.pid, SIGKILL);
+          waitpid(worker.pid, &status, 0);
+          break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    }
+    worker = WorkerProcess{};
+  }
+
+  void WorkerPool::restart(std::size_t index)
+  {
+    WorkerProcess &worker = workers_[index];
+    if (worker.in != -1)
+      close(worker.in);
+    if (worker.out != -1)
+      close(worker.out);
+    // A hung worker may ignore EOF; SIGTERM then SIGKILL happen off this thread
+    reaper().terminate(worker.pid);
+    worker = WorkerProcess{};
+    spawn(worker);
+  }
+
+}
@@ -0,0 +1,70 @@
+#ifndef PRERENDER_WORKERPOOL_H
+#define PRERENDER_WORKERPOOL_H
+
+#include "Phases.h"
+#include "Process.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace Prerender
+{
+    class WorkerError : public std::runtime_error {
+      public:
+      using std::runtime_error::runtime_error;
+    };
+
+    // One long-lived `node PRERENDER_SCRIPT --server` process.
+    // Jobs and replies are framed as a 4 byte big-endian length followed by the JSON text.
+    struct WorkerProcess
+    {
+      pid_t pid = -1;
+      int in = -1;  // parent -> child stdin
+      int out = -1; // child stdout -> parent
+    };
+
+    class WorkerPool
+    {
+    public:
+      explicit WorkerPool(std::size_t size);
+      ~WorkerPool();
+
+      WorkerPool(const WorkerPool &) = delete;
+      WorkerPool &operator=(const WorkerPool &) = delete;
+
+      // Blocks until a worker is free, sends one framed job and returns the framed reply.
+      // A worker that fails mid job is restarted before the error is thrown.
+      // Spawn (only when the worker needs a restart), write and render are timed into timings.
+      // Past deadline the worker is handed to the reaper, restarted, and TimeoutError thrown.
+      std::string request(const std::string &payload, PhaseTimings &timings, Deadline deadline);
+
+      std::size_t size() const { return workers_.size(); }
+
+    private:
+      std::size_t acquire();
+      void release(std::size_t index);
+      void spawn(WorkerProcess &worker);
+      void closeFds(WorkerProcess &worker);
+      void stop(WorkerProcess &worker, Deadline deadline); // SIGKILL only past deadline
+      void restart(std::size_t index); // kills through the reaper, never blocks
+
+      std::mutex mutex_;
+      std::condition_variable idle_;
+      std::vector<WorkerProcess> workers_;
+      std::vector<std::size_t> free_;
+      bool stopping_ = false;
+
+      static constexpr std::uint32_t MAX_FRAME_BYTES = 64 * 1024 * 1024;
+      // Time healthy workers get to exit after stdin EOF on shutdown
+      static constexpr std::chrono::milliseconds STOP_GRACE{2000};
+    };
+
+}
+
+#endif // PRERENDER_WORKERPOOL_H
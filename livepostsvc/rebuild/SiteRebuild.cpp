@@ -0,0 +1,244 @@
+#include "SiteRebuild.h"
+#include "../routes/FetchPost.h"
+#include "../prerender/Pipeline.h"
+#include "../prerender/Prerender.h"
+#include "livepostsmodel/pq.h"
+#include <mtlog/mt_log.hpp>
+
+#include <libpq-fe.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+namespace net = boost::asio;
+
+namespace Rebuild
+{
+
+  static double percentile(std::vector<double> &sorted, double p)
+  {
+    if (sorted.empty())
+      return 0;
+    auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+  }
+
+  static double msSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  // Renders one batch in a single node invocation, or post by post once perPost is set.
+  // A batch that fails as a whole is retried post by post; when any of those succeed the
+  // script evidently cannot render batches, and perPost is set for the rest of the run.
+  // Appends a render time per post to postMs (a batch's time split evenly across its posts)
+  // and returns how many posts failed.
+  static std::size_t renderBatch(const std::vector<std::string> &batch, std::atomic<bool> &perPost,
+                                 std::vector<double> &postMs)
+  {
+    auto logError = [](const std::string &line)
+    {
+      mt_logging::logger().log({line, mt_logging::LogLevel::Error, true});
+    };
+
+    if (!perPost)
+    {
+      std::string error;
+      auto started = Clock::now(); // on the pipeline thread, so queue wait is not render time
+      try
+      {
+        std::size_t failed = 0;
+        for (const auto &result : Prerender::prerenderBatch(batch, true))
+        {
+          if (result.ok)
+            continue;
+          failed++;
+          logError(fmt::format("Rebuild site post {} failed: {}", result.slug, result.error));
+        }
+        postMs.insert(postMs.end(), batch.size(), msSince(started) / batch.size());
+        return failed;
+      }
+      catch (const std::string &e)
+      {
+        error = e;
+      }
+      catch (const std::exception &e)
+      {
+        error = e.what();
+      }
+      logError(fmt::format("Rebuild site batch of {} failed, rendering its posts one at a time: {}", batch.size(), error));
+    }
+
+    std::size_t failed = 0;
+    for (const auto &post : batch)
+    {
+      auto started = Clock::now();
+      try
+      {
+        Prerender::prerenderPost(post, true);
+      }
+      catch (const std::string &e)
+      {
+        failed++;
+        logError(fmt::format("Rebuild site post {} failed: {}", json::parse(post).value("id", 0), e));
+      }
+      catch (const std::exception &e)
+      {
+        failed++;
+        logError(fmt::format("Rebuild site post {} failed: {}", json::parse(post).value("id", 0), e.what()));
+      }
+      postMs.push_back(msSince(started));
+    }
+    if (failed < batch.size() && !perPost.exchange(true))
+    {
+      mt_logging::logger().log({"Rebuild site: the prerender script does not render batches, continuing post by post",
+                                mt_logging::LogLevel::Info,
+                                true});
+    }
+    return failed;
+  }
+
+  Report rebuildSite(const Options &options)
+  {
+    const char *keywords[] = {"dbname", "host", "port", "user", "password", nullptr};
+    const char *values[] = {options.dbname.c_str(), options.host.c_str(), options.port.c_str(),
+                            options.user.c_str(), options.password.c_str(), nullptr};
+    std::unique_ptr<PGconn, decltype(&PQfinish)> conn(PQconnectdbParams(keywords, values, 0), &PQfinish);
+    if (PQstatus(conn.get()) != CONNECTION_OK)
+    {
+      throw std::runtime_error("Rebuild site connection failed: " + std::string(PQerrorMessage(conn.get())));
+    }
+
+    // Same query as GET /api/v1/liveposts/posts, streamed one row at a time
+    std::string live = std::to_string(true);
+    const char *params[] = {live.c_str()};
+    if (!PQsendQueryParams(conn.get(), Routes::LivePosts::FetchPostOp::sql, 1, nullptr, params, nullptr, nullptr, 0) ||
+        !PQsetSingleRowMode(conn.get()))
+    {
+      throw std::runtime_error("Rebuild site query failed: " + std::string(PQerrorMessage(conn.get())));
+    }
+
+    std::size_t concurrency = options.concurrency == 0 ? 1 : options.concurrency;
+    std::mutex mutex;
+    std::condition_variable slots;
+    std::size_t inFlight = 0; // batches
+    std::atomic<bool> perPost{false};
+    Report report;
+    std::vector<double> durationsMs; // per post
+    std::string queryError;
+
+    auto release = [&]
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      inFlight--;
+      slots.notify_all();
+    };
+    auto drain = [&]
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      slots.wait(lock, [&]
+                 { return inFlight == 0; });
+    };
+
+    auto submitBatch = [&](std::vector<std::string> batch)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        slots.wait(lock, [&]
+                   { return inFlight < concurrency; });
+        inFlight++;
+      }
+      try
+      {
+        net::post(Prerender::executor(),
+                  [&, batch = std::move(batch)]
+                  {
+                    std::vector<double> postMs;
+                    std::size_t failed = renderBatch(batch, perPost, postMs);
+                    {
+                      std::lock_guard<std::mutex> lock(mutex);
+                      durationsMs.insert(durationsMs.end(), postMs.begin(), postMs.end());
+                      report.failed += failed;
+                    }
+                    release();
+                  });
+      }
+      catch (...)
+      {
+        release(); // never submitted
+        throw;
+      }
+    };
+
+    Prerender::BatchLimits limits;
+    std::vector<std::string> pending;
+    std::size_t pendingBytes = 0;
+    auto flush = [&]
+    {
+      for (auto &batch : Prerender::makeBatches(pending, limits))
+        submitBatch(std::move(batch));
+      pending.clear();
+      pendingBytes = 0;
+    };
+
+    auto start = Clock::now();
+    try
+    {
+      while (PGresult *res = PQgetResult(conn.get()))
+      {
+        auto status = PQresultStatus(res);
+        if (status != PGRES_SINGLE_TUPLE)
+        {
+          if (status != PGRES_TUPLES_OK)
+            queryError = PQresultErrorMessage(res);
+          PQclear(res);
+          continue; // drain until PQgetResult returns null
+        }
+
+        LivePostsModel::Post post = LivePostsModel::PG::Posts::fromPGRes(res, PQnfields(res), 0);
+        PQclear(res);
+        json jsonPost = post;
+        pending.push_back(jsonPost.dump()); // a template change leaves content hashes untouched, so force
+        pendingBytes += pending.back().size();
+        report.posts++;
+
+        if (pending.size() >= limits.maxPosts || pendingBytes >= limits.maxBytes)
+          flush();
+      }
+      flush();
+    }
+    catch (...)
+    {
+      drain(); // callbacks still reference this frame
+      throw;
+    }
+    drain();
+
+    if (!queryError.empty())
+    {
+      throw std::runtime_error("Rebuild site query failed: " + queryError);
+    }
+
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    report.postsPerSecond = report.seconds > 0 ? report.posts / report.seconds : 0;
+    std::sort(durationsMs.begin(), durationsMs.end());
+    report.p50Ms = percentile(durationsMs, 0.50);
+    report.p99Ms = percentile(durationsMs, 0.99);
+
+    mt_logging::logger().log({fmt::format("Rebuild site: {} posts ({} failed) in {:.2f}s, {:.1f} posts/s, per post p50 {:.1f}ms, p99 {:.1f}ms",
+                                          report.posts, report.failed, report.seconds,
+                                          report.postsPerSecond, report.p50Ms, report.p99Ms),
+                              mt_logging::LogLevel::Info,
+                              true});
+    return report;
+  }
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Rebuild
+{
+
+  struct Options
+  {
+    std::string dbname;
+    std::string host;
+    std::string port;
+    std::string user;
+    std::string password;
+    std::size_t concurrency = 2; // batches in flight at once
+  };
+
+  struct Report
+  {
+    std::size_t posts = 0;
+    std::size_t failed = 0;
+    double seconds = 0;
+    double postsPerSecond = 0;
+    // Per post render time, from the start of the render. A batched render's time is split
+    // evenly across its posts.
+    double p50Ms = 0;
+    double p99Ms = 0;
+  };
+
+  // Streams every live post (FetchPostOp query, single row mode), groups the rows with
+  // Prerender::makeBatches and renders each batch with prerenderBatch on the pipeline
+  // threads, one node invocation per batch. When a script cannot render batches the run
+  // falls back to prerenderPost, one post at a time. Unchanged posts are rendered too so
+  // template changes are picked up; each render overwrites its render cache entry. Requires
+  // Prerender::startPipeline with at least options.concurrency threads.
+  Report rebuildSite(const Options &options);
+
+}
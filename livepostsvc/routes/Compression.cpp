@@ -0,0 +1,106 @@
+#include "Compression.h"
+#include "../metrics/Metrics.h"
+
+#include <mtlog/mt_log.hpp>
+#include <exception>
+#include <memory>
+#include <string>
+
+namespace Routes
+{
+
+  static CompressionOptions options;
+  static std::unique_ptr<net::thread_pool> pool;
+
+  void startResponseCompression(const CompressionOptions &value)
+  {
+    options = value;
+    if (options.level > 0 && options.threads > 0)
+      pool = std::make_unique<net::thread_pool>(options.threads);
+  }
+
+  void stopResponseCompression()
+  {
+    if (pool)
+    {
+      pool->join();
+      pool.reset();
+    }
+  }
+
+  Compress::Encoding negotiateEncoding(const http::request<http::string_body> &req,
+                                       http::response<http::string_body> &res)
+  {
+    if (options.level <= 0 || res.find(http::field::content_encoding) != res.end())
+      return Compress::Encoding::Identity;
+
+    // A 304 carries the Vary its 200 would have, and caches must key a 200 on Accept-Encoding
+    // even when this body was too small to compress
+    bool ok = res.result() == http::status::ok;
+    if (ok || res.result() == http::status::not_modified)
+      res.set(http::field::vary, "Accept-Encoding");
+    if (!ok || res.body().size() < options.minBytes)
+      return Compress::Encoding::Identity;
+
+    auto header = req.find(http::field::accept_encoding);
+    if (header == req.end())
+      return Compress::Encoding::Identity;
+
+    auto value = header->value();
+    std::string_view acceptEncoding(value.data(), value.size());
+    if (Compress::accepts(acceptEncoding, "gzip"))
+      return Compress::Encoding::Gzip;
+    if (Compress::accepts(acceptEncoding, "deflate"))
+      return Compress::Encoding::Deflate;
+    return Compress::Encoding::Identity;
+  }
+
+  void encodeResponse(http::response<http::string_body> &res, Compress::Encoding encoding)
+  {
+    static Metrics::Counter &bytesIn = Metrics::registry().counter(
+        "response_compression_bytes_total", "Response body bytes before and after compression", {{"stage", "in"}});
+    static Metrics::Counter &bytesOut = Metrics::registry().counter(
+        "response_compression_bytes_total", "Response body bytes before and after compression", {{"stage", "out"}});
+
+    std::string encoded;
+    try
+    {
+      encoded = Compress::encode(encoding, res.body(), options.level);
+    }
+    catch (const std::exception &e)
+    {
+      mt_logging::logger().log({fmt::format("Response compression failed, sending identity: {}", e.what()),
+                                mt_logging::LogLevel::Error,
+                                true});
+      return;
+    }
+    if (encoded.size() >= res.body().size())
+      return;
+
+    bytesIn.inc(res.body().size());
+    bytesOut.inc(encoded.size());
+
+    auto etag = res.find(http::field::etag);
+    if (etag != res.end())
+    {
+      std::string value(etag->value().data(), etag->value().size());
+      if (!value.starts_with("W/"))
+        res.set(http::field::etag, "W/" + value);
+    }
+
+    res.body() = std::move(encoded);
+    res.set(http::field::content_encoding, Compress::name(encoding));
+    res.prepare_payload();
+  }
+
+  bool offloadEncoding(std::size_t bytes)
+  {
+    return pool && bytes >= options.offloadBytes;
+  }
+
+  net::thread_pool &compressionPool()
+  {
+    return *pool;
+  }
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../compress/Compress.h"
+#include "apiserver/HttpRoute.h"
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cstddef>
+#include <utility>
+
+namespace Routes
+{
+  struct CompressionOptions
+  {
+    int level = 6;                        // zlib 1..9, 0 sends every response uncompressed
+    std::size_t minBytes = 1024;          // smaller bodies are not worth the CPU
+    std::size_t offloadBytes = 64 * 1024; // larger bodies compress off the ASIO threads
+    std::size_t threads = 1;              // compression threads, 0 compresses inline
+  };
+
+  // Set once in main before run()
+  void startResponseCompression(const CompressionOptions &options);
+  void stopResponseCompression();
+
+  // gzip, else deflate, when res is worth compressing and req accepts it; Identity otherwise.
+  // Sets Vary: Accept-Encoding on every 200 and 304 while compression is on, whatever the size.
+  Compress::Encoding negotiateEncoding(const http::request<http::string_body> &req,
+                                       http::response<http::string_body> &res);
+
+  // Encodes the body and sets Content-Encoding. A strong ETag becomes weak since the bytes now
+  // differ per coding; If-None-Match compares weakly so revalidation still matches. On failure
+  // or no gain the response is left as it was.
+  void encodeResponse(http::response<http::string_body> &res, Compress::Encoding encoding);
+
+  // True when a body of this size goes to the compression threads
+  bool offloadEncoding(std::size_t bytes);
+  net::thread_pool &compressionPool();
+
+  // Call on the session strand in place of send(res). Large bodies are compressed on the
+  // compression threads and sent from strand afterwards; self keeps the op (and its session)
+  // alive meanwhile.
+  template <typename Self, typename Strand, typename Send>
+  void sendCompressed(Self self, const Strand &strand, Send send,
+                      const http::request<http::string_body> &req,
+                      http::response<http::string_body> res)
+  {
+    auto encoding = negotiateEncoding(req, res);
+    if (encoding == Compress::Encoding::Identity || !offloadEncoding(res.body().size()))
+    {
+      if (encoding != Compress::Encoding::Identity)
+        encodeResponse(res, encoding);
+      send(std::move(res));
+      return;
+    }
+
+    net::post(compressionPool(),
+              [self = std::move(self), strand, send = std::move(send), res = std::move(res), encoding]() mutable
+              {
+                encodeResponse(res, encoding);
+                net::dispatch(strand,
+                              [self = std::move(self), send = std::move(send), res = std::move(res)]() mutable
+                              {
+                                send(std::move(res));
+                              });
+              });
+  }
+}
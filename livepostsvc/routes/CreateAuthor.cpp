@@ -1,4 +1,8 @@
 #include "CreateAuthor.h"
+#include "Compression.h"
+#include "LazyDb.h"
+#include "Statements.h"
+#include "../cache/AuthorCache.h"
 
 #include "apiserver/Session.h"
 #include "apiserver/PQClient.h"
@@ -68,12 +72,12 @@ namespace Routes::LivePosts
   void CreateAuthorOp::doWork()
   {
     auto self = shared_from_this();
-    ctx_.db->asyncExecParams(
-        sql,
+    Statements::exec(
+        *ctx_.db,
+        Statements::Id::CreateAuthor,
         paramValues_,
         paramLengths_,
         paramFormats_,
-        static_cast<int>(paramValues_.size()),
         [self](PGresult *res)
         { self->onWorkResult(res); });
   }
@@ -112,6 +116,9 @@ namespace Routes::LivePosts
       int cols = PQnfields(res);
       auto author = LivePostsModel::PG::Users::fromPGRes(res, cols, 0);
       PQclear(res);
+      Cache::authorCache().put(author); // the front end fetches it right after sign up
+      Cache::authorCache().bump();
+      markWrite();
       
       json root;
       root["createUser"] = author;
@@ -158,7 +165,7 @@ namespace Routes::LivePosts
          req = std::move(req),
          body = std::move(body)]() mutable
         {
-          send(success_request(req, body));
+          sendCompressed(self, self->ctx_.session->strand(), std::move(send), req, success_request(req, body));
         });
   }
 }
\ No newline at end of file
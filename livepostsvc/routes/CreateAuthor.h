@@ -40,6 +40,8 @@ namespace Routes::LivePosts
     std::vector<int> paramLengths_;
     std::vector<int> paramFormats_;
 
+  public:
+    // Registered in Routes::Statements
     static constexpr const char *sql =
           "INSERT INTO \"Users\" "
           "(\"authId\", \"name\") VALUES ($1, $2) "
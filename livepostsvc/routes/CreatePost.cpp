@@ -1,4 +1,7 @@
 #include "CreatePost.h"
+#include "LazyDb.h"
+#include "Statements.h"
+#include "../cache/ResponseCache.h"
 #include "apiserver/Session.h"
 #include "apiserver/PQClient.h"
 #include "apiserver/Response.h"
@@ -68,12 +71,12 @@ namespace Routes::LivePosts
   void CreatePostOp::doWork()
   {
     auto self = shared_from_this();
-    ctx_.db->asyncExecParams(
-        createPostSql,
+    Statements::exec(
+        *ctx_.db,
+        Statements::Id::CreatePost,
         paramValues_,
         paramLengths_,
         paramFormats_,
-        static_cast<int>(paramValues_.size()),
         [self](PGresult *res)
         { self->handleWork(res); });
   }
@@ -167,6 +170,8 @@ namespace Routes::LivePosts
       return;
     }
     PQclear(res);
+    Cache::postsCache().bump(); // new post must show in GET /posts
+    markWrite();
 
     try
     {
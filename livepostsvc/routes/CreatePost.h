@@ -41,6 +41,8 @@ namespace Routes::LivePosts
 
     static constexpr const char *CREATE_BOARD_INIT = "0,0,0,0,0,0,0,0,0";
 
+  public:
+    // Registered in Routes::Statements
     static constexpr const char *createPostSql =
         "INSERT INTO \"Posts\" "
         "(\"title\", \"content\", \"userId\", \"date\", \"live\") VALUES ($1, $2, $3, NOW(), $4) "
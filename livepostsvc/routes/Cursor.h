@@ -0,0 +1,106 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Routes::LivePosts
+{
+  // Keyset position after the last row of a page: the row's "date" in microseconds since
+  // the Postgres epoch (bound back as a binary timestamp, so it compares without loss) and
+  // its id as the tie breaker.
+  struct PostCursor
+  {
+    std::int64_t date = 0;
+    int id = 0;
+  };
+
+  namespace detail
+  {
+    inline constexpr std::string_view BASE64URL =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    inline std::string base64urlEncode(std::string_view in)
+    {
+      std::string out;
+      out.reserve((in.size() + 2) / 3 * 4);
+      std::size_t i = 0;
+      for (; i + 2 < in.size(); i += 3)
+      {
+        unsigned v = (unsigned char)in[i] << 16 | (unsigned char)in[i + 1] << 8 | (unsigned char)in[i + 2];
+        out += BASE64URL[v >> 18 & 63];
+        out += BASE64URL[v >> 12 & 63];
+        out += BASE64URL[v >> 6 & 63];
+        out += BASE64URL[v & 63];
+      }
+      if (i + 1 == in.size())
+      {
+        unsigned v = (unsigned char)in[i] << 16;
+        out += BASE64URL[v >> 18 & 63];
+        out += BASE64URL[v >> 12 & 63];
+      }
+      else if (i + 2 == in.size())
+      {
+        unsigned v = (unsigned char)in[i] << 16 | (unsigned char)in[i + 1] << 8;
+        out += BASE64URL[v >> 18 & 63];
+        out += BASE64URL[v >> 12 & 63];
+        out += BASE64URL[v >> 6 & 63];
+      }
+      return out; // unpadded
+    }
+
+    inline std::optional<std::string> base64urlDecode(std::string_view in)
+    {
+      std::string out;
+      unsigned v = 0;
+      int bits = 0;
+      for (char c : in)
+      {
+        auto pos = BASE64URL.find(c);
+        if (pos == std::string_view::npos)
+          return std::nullopt;
+        v = (v << 6) | static_cast<unsigned>(pos);
+        bits += 6;
+        if (bits >= 8)
+        {
+          bits -= 8;
+          out += static_cast<char>((v >> bits) & 0xff);
+        }
+      }
+      return out;
+    }
+  }
+
+  // Opaque to clients: base64url("<date micros>|<id>")
+  inline std::string encodeCursor(const PostCursor &cursor)
+  {
+    return detail::base64urlEncode(std::to_string(cursor.date) + "|" + std::to_string(cursor.id));
+  }
+
+  inline std::optional<PostCursor> decodeCursor(std::string_view text)
+  {
+    auto raw = detail::base64urlDecode(text);
+    if (!raw)
+      return std::nullopt;
+
+    auto bar = raw->find('|');
+    if (bar == std::string::npos || bar == 0)
+      return std::nullopt;
+
+    PostCursor cursor;
+    const char *first = raw->data();
+    const char *middle = raw->data() + bar;
+    auto [dateEnd, dateEc] = std::from_chars(first, middle, cursor.date);
+    if (dateEc != std::errc() || dateEnd != middle)
+      return std::nullopt;
+
+    first = middle + 1;
+    const char *last = raw->data() + raw->size();
+    auto [end, ec] = std::from_chars(first, last, cursor.id);
+    if (ec != std::errc() || end != last || first == last)
+      return std::nullopt;
+    return cursor;
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "apiserver/HttpRoute.h"
+#include "apiserver/Response.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Routes
+{
+  // Strong validator from the response body: "<fnv1a 64 hex>"
+  inline std::string strongETag(std::string_view body)
+  {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : body)
+    {
+      hash ^= c;
+      hash *= 0x100000001b3ULL;
+    }
+    return fmt::format("\"{:016x}\"", hash);
+  }
+
+  // If-None-Match uses the weak comparison: W/ prefixes are ignored, "*" matches anything
+  inline bool etagMatches(std::string_view ifNoneMatch, std::string_view etag)
+  {
+    while (!ifNoneMatch.empty())
+    {
+      auto comma = ifNoneMatch.find(',');
+      std::string_view tag = ifNoneMatch.substr(0, comma);
+      ifNoneMatch = comma == std::string_view::npos ? std::string_view() : ifNoneMatch.substr(comma + 1);
+
+      while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t'))
+        tag.remove_prefix(1);
+      while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t'))
+        tag.remove_suffix(1);
+      if (tag == "*")
+        return true;
+      if (tag.starts_with("W/"))
+        tag.remove_prefix(2);
+      if (tag == etag)
+        return true;
+    }
+    return false;
+  }
+
+  inline bool notModified(const http::request<http::string_body> &req, std::string_view etag)
+  {
+    auto header = req.find(http::field::if_none_match);
+    if (header == req.end())
+      return false;
+    auto value = header->value();
+    return etagMatches(std::string_view(value.data(), value.size()), etag);
+  }
+
+  // 200 with the ETag set, or 304 with no body when the request already holds it
+  inline http::response<http::string_body> conditionalSuccess(const http::request<http::string_body> &req,
+                                                              const std::string &body,
+                                                              const std::string &etag)
+  {
+    if (notModified(req, etag))
+    {
+      auto res = Rest::Response::success_request(req, "");
+      res.result(http::status::not_modified);
+      res.body().clear();
+      res.erase(http::field::content_length);
+      res.erase(http::field::content_type);
+      res.set(http::field::etag, etag);
+      return res;
+    }
+    auto res = Rest::Response::success_request(req, body);
+    res.set(http::field::etag, etag);
+    return res;
+  }
+}
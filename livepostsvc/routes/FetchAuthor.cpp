@@ -1,4 +1,9 @@
 #include "FetchAuthor.h"
+#include "Compression.h"
+#include "LazyDb.h"
+#include "Statements.h"
+#include "../cache/AuthorCache.h"
+#include "../cache/SingleFlight.h"
 
 #include "apiserver/Session.h"
 #include "apiserver/PQClient.h"
@@ -25,7 +30,39 @@ namespace Routes::LivePosts
     if (!parseReq())
       return; // parseReq already sent error
 
-    doWork();
+    // Taken before the lookup: a query started before a create is never joined after it
+    flightKey_ = params_["authId"] + "@" + std::to_string(Cache::authorCache().version());
+
+    // Registered with DbRequirement::None: a hit never borrows a pooled connection
+    if (auto user = Cache::authorCache().get(params_["authId"]))
+    {
+      json root;
+      root["fetchUserByAuthId"] = json::array();
+      root["fetchUserByAuthId"].push_back(*user);
+      sendSuccess(root.dump());
+      return;
+    }
+
+    // The same author already being queried: answer with its result instead of a second query
+    auto self = shared_from_this();
+    leading_ = Cache::authorsFlight().join(flightKey_, [self](std::shared_ptr<const Cache::FlightResult> result)
+                                           {
+                                             if (result->error.empty())
+                                               self->sendSuccess(result->body);
+                                             else
+                                               self->sendError(result->error); });
+    if (!leading_)
+      return;
+
+    acquireReadDb([self](std::shared_ptr<Rest::PQClient> db)
+              {
+                if (!db)
+                {
+                  self->sendError("Fetch author failed: no database connection");
+                  return;
+                }
+                self->ctx_.db = std::move(db);
+                self->doWork(); });
   }
 
   bool FetchAuthorOp::parseReq()
@@ -39,17 +76,19 @@ namespace Routes::LivePosts
     }
     std::cerr << "params_ [" << params_["authId"] << "] " << std::endl;//[" << params_["user"] << "]" << std::endl;
 
+    // Binary text is the raw bytes, so the server skips the text input path
     paramStrings_.clear();
     paramStrings_.push_back(params_["authId"]);
 
-    // Build paramValues_
+    // Build paramValues_ + lengths
     paramValues_.clear();
+    paramLengths_.clear();
     for (auto &s : paramStrings_)
-      paramValues_.push_back(s.c_str());
-
-    // lengths + formats
-    paramLengths_.assign(paramStrings_.size(), 0);
-    paramFormats_.assign(paramStrings_.size(), 0);
+    {
+      paramValues_.push_back(s.data());
+      paramLengths_.push_back(static_cast<int>(s.size()));
+    }
+    paramFormats_.assign(paramStrings_.size(), 1);
 
     return true;
   }
@@ -57,12 +96,12 @@ namespace Routes::LivePosts
   void FetchAuthorOp::doWork()
   {
     auto self = shared_from_this();
-    ctx_.db->asyncExecParams(
-        sql,
+    Statements::exec(
+        *ctx_.db,
+        Statements::Id::FetchAuthor,
         paramValues_,
         paramLengths_,
         paramFormats_,
-        static_cast<int>(paramValues_.size()),
         [self](PGresult *res)
         { self->onWorkResult(res); });
   }
@@ -114,6 +153,7 @@ namespace Routes::LivePosts
       for (int row = 0; row < rows; row++)
       {
         LivePostsModel::User user = LivePostsModel::PG::Users::fromPGRes(res, cols, row);
+        Cache::authorCache().put(user); // unknown authIds are not cached, a create may follow
         root["fetchUserByAuthId"].push_back(user);
       }
       PQclear(res);
@@ -126,9 +166,18 @@ namespace Routes::LivePosts
     }
   }
 
+  void FetchAuthorOp::finishFlight(Cache::FlightResult result)
+  {
+    if (!leading_)
+      return;
+    leading_ = false;
+    Cache::authorsFlight().finish(flightKey_, std::make_shared<const Cache::FlightResult>(std::move(result)));
+  }
+
   // --- Local helpers (no DbOpBase) ---
   void FetchAuthorOp::sendError(const std::string &msg)
   {
+    finishFlight(Cache::FlightResult{msg, {}, {}});
     auto session = ctx_.session;
     auto &strand = session->strand();
     auto req = ctx_.req;
@@ -145,6 +194,7 @@ namespace Routes::LivePosts
 
   void FetchAuthorOp::sendSuccess(const std::string &body)
   {
+    finishFlight(Cache::FlightResult{{}, body, {}}); // followers hash their own ETag
     auto session = ctx_.session;
     auto &strand = session->strand();
     auto req = ctx_.req;
@@ -155,7 +205,8 @@ namespace Routes::LivePosts
          req = std::move(req),
          body = std::move(body)]() mutable
         {
-          send(success_request(req, body));
+          sendCompressed(self, self->ctx_.session->strand(), std::move(send), req,
+                         conditionalSuccess(req, body, strongETag(body)));
         });
   }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "ETag.h"
+#include "../cache/SingleFlight.h"
 #include "RouteCommon.h"
 #include "livepostsmodel/model.h"
 #include "apiserver/Session.h"
@@ -27,10 +29,15 @@ namespace Routes::LivePosts
     void onWorkResult(PGresult *res);
 
     void sendError(const std::string &msg);
+    // Sets a content ETag; 304 instead of body when If-None-Match already holds it
     void sendSuccess(const std::string &body);
+    // Hands the answer to requests that joined this one's query, when it leads
+    void finishFlight(Cache::FlightResult result);
 
   private:
     Rest::Parameters params_;
+    std::string flightKey_; // authId@authorCache().version(), taken before the cache lookup
+    bool leading_ = false;  // runs the query for authorsFlight() followers
     LivePostsModel::User user_;
 
     RequestContext ctx_;
@@ -41,6 +48,8 @@ namespace Routes::LivePosts
     std::vector<int> paramLengths_;
     std::vector<int> paramFormats_;
 
+  public:
+    // Registered in Routes::Statements
     static constexpr const char *sql = "SELECT "
                                          "id, \"authId\", \"name\" "
                                          "FROM \"Users\" "
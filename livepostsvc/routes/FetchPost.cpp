@@ -1,4 +1,11 @@
 #include "FetchPost.h"
+#include "Compression.h"
+#include "LazyDb.h"
+#include "PgBinary.h"
+#include "PgJson.h"
+#include "Statements.h"
+#include "../cache/ResponseCache.h"
+#include "../cache/SingleFlight.h"
 
 #include "apiserver/Session.h"
 #include "apiserver/PQClient.h"
@@ -7,6 +14,9 @@
 #include <nlohmann/json.hpp>
 #include <mtlog/mt_log.hpp>
 #include "livepostsmodel/pq.h"
+#include <algorithm>
+#include <charconv>
+#include <iterator>
 
 using json = nlohmann::json;
 using Rest::RouteHandler;
@@ -25,36 +35,171 @@ namespace Routes::LivePosts
     if (!parseReq())
       return; // parseReq already sent error
 
-    doWork();
+    // Taken before the lookup so a create or stage committed meanwhile discards this page, and
+    // so a request after that write never joins this request's query
+    cacheVersion_ = Cache::postsCache().version();
+    flightKey_ = cacheKey_ + "@" + std::to_string(cacheVersion_);
+
+    // Registered with DbRequirement::None: a hit (or a 304 for it) never borrows a pooled connection
+    if (auto cached = Cache::postsCache().get(cacheKey_))
+    {
+      sendSuccess(cached->body, cached->etag);
+      return;
+    }
+
+    // The same page already being queried: answer with its result instead of a second query
+    auto self = shared_from_this();
+    leading_ = Cache::postsFlight().join(flightKey_, [self](std::shared_ptr<const Cache::FlightResult> result)
+                                         {
+                                           if (result->error.empty())
+                                             self->sendSuccess(result->body, result->etag);
+                                           else
+                                             self->sendError(result->error); });
+    if (!leading_)
+      return;
+
+    acquireReadDb([self](std::shared_ptr<Rest::PQClient> db)
+              {
+                if (!db)
+                {
+                  self->sendError("Fetch post failed: no database connection");
+                  return;
+                }
+                self->ctx_.db = std::move(db);
+                self->doWork(); });
   }
 
   bool FetchPostOp::parseReq()
   {
-    // Build paramStrings_ (owned)
+    auto [route_url, query_params] = RouteHandler::parse_query_params(std::string(ctx_.req.target()));
+
+    auto limitParam = query_params.find("limit");
+    if (limitParam != query_params.end())
+    {
+      const std::string &text = limitParam->second;
+      auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), limit_);
+      if (ec != std::errc() || end != text.data() + text.size() || limit_ < 1)
+      {
+        sendError("Invalid limit");
+        return false;
+      }
+      limit_ = std::min(limit_, MAX_LIMIT);
+    }
+
+    auto cursorParam = query_params.find("cursor");
+    if (cursorParam != query_params.end() && !cursorParam->second.empty())
+    {
+      cursor_ = decodeCursor(cursorParam->second);
+      if (!cursor_)
+      {
+        sendError("Invalid cursor");
+        return false;
+      }
+    }
+
+    auto fieldsParam = query_params.find("fields");
+    if (fieldsParam != query_params.end() && !fieldsParam->second.empty())
+    {
+      if (!parseFields(fieldsParam->second))
+      {
+        sendError("Invalid fields");
+        return false;
+      }
+    }
+
+    cacheKey_ = std::to_string(limit_) + "|" + (cursor_ ? cursorParam->second : "");
+    if (!fields_.empty())
+    {
+      projectedSql_ = projectedSql();
+      for (auto field : fields_)
+        cacheKey_ += std::string("|") + POST_FIELDS[field].name;
+    }
+
+    // Build paramStrings_ (owned), binary: bool live, timestamp date, int4 id, int8 LIMIT
     paramStrings_.clear();
-    paramStrings_.push_back(std::to_string(true));
+    paramStrings_.push_back(PgBinary::encodeBool(true));
+    if (cursor_)
+    {
+      paramStrings_.push_back(PgBinary::encodeTimestamp(cursor_->date));
+      paramStrings_.push_back(PgBinary::encodeInt4(cursor_->id));
+    }
+    paramStrings_.push_back(PgBinary::encodeInt8(limit_ + 1));
 
-    // Build paramValues_
+    // Build paramValues_ + lengths (binary values may hold zero bytes)
     paramValues_.clear();
+    paramLengths_.clear();
     for (auto &s : paramStrings_)
-      paramValues_.push_back(s.c_str());
+    {
+      paramValues_.push_back(s.data());
+      paramLengths_.push_back(static_cast<int>(s.size()));
+    }
+    paramFormats_.assign(paramStrings_.size(), 1);
+
+    return true;
+  }
+
+  bool FetchPostOp::parseFields(const std::string &list)
+  {
+    std::vector<bool> wanted(std::size(POST_FIELDS), false);
+    std::string_view rest(list);
+    while (!rest.empty())
+    {
+      auto comma = rest.find(',');
+      std::string_view name = rest.substr(0, comma);
+      rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
 
-    // lengths + formats
-    paramLengths_.assign(paramStrings_.size(), 0);
-    paramFormats_.assign(paramStrings_.size(), 0);
+      auto field = std::find_if(std::begin(POST_FIELDS), std::end(POST_FIELDS), [name](const PostField &f)
+                                { return name == f.name; });
+      if (field == std::end(POST_FIELDS))
+        return false;
+      wanted[static_cast<std::size_t>(field - std::begin(POST_FIELDS))] = true;
+    }
 
+    // Canonical order so "title,id" and "id,title" share a cache entry
+    fields_.clear();
+    for (std::size_t i = 0; i < wanted.size(); i++)
+    {
+      std::string_view name = POST_FIELDS[i].name;
+      if (wanted[i] || name == "id" || name == "date")
+        fields_.push_back(i);
+    }
     return true;
   }
 
+  std::string FetchPostOp::projectedSql() const
+  {
+    std::string sql = "SELECT ";
+    bool users = false;
+    for (std::size_t i = 0; i < fields_.size(); i++)
+    {
+      if (i != 0)
+        sql += ", ";
+      sql += POST_FIELDS[fields_[i]].select;
+      users = users || std::string_view(POST_FIELDS[fields_[i]].name) == "userName";
+    }
+    // The join is only needed for userName
+    sql += users ? " FROM \"Posts\" LEFT JOIN \"Users\" ON \"Posts\".\"userId\" = \"Users\".\"id\" "
+                 : " FROM \"Posts\" ";
+    sql += cursor_ ? "WHERE \"live\"=$1 AND (\"date\", \"Posts\".\"id\") < ($2, $3) "
+                     "ORDER BY \"date\" DESC, \"Posts\".\"id\" DESC "
+                     "LIMIT $4;"
+                   : "WHERE \"live\"=$1 "
+                     "ORDER BY \"date\" DESC, \"Posts\".\"id\" DESC "
+                     "LIMIT $2;";
+    return sql;
+  }
+
   void FetchPostOp::doWork()
   {
     auto self = shared_from_this();
-    ctx_.db->asyncExecParams(
-        sql,
+    auto statement = cursor_ ? Statements::Id::FetchPostsPageAfter : Statements::Id::FetchPostsPage;
+    Statements::exec(
+        *ctx_.db,
+        statement,
+        fields_.empty() ? Statements::get(statement).sql : projectedSql_.c_str(),
         paramValues_,
         paramLengths_,
         paramFormats_,
-        static_cast<int>(paramValues_.size()),
         [self](PGresult *res)
         { self->onWorkResult(res); });
   }
@@ -87,40 +232,58 @@ namespace Routes::LivePosts
       return;
     }
 
-    // --- Success path: parse the returned rows ---
+    // --- Success path: serialize the returned rows ---
     try
     {
-      json root;
-      int cols = PQnfields(res);
       int rows = PQntuples(res);
+      int pageRows = std::min(rows, limit_); // the extra row only signals a next page
 
-      if (rows == 0)
+      std::string nextCursor;
+      if (rows > limit_)
       {
-        root["fetchPosts"] = json::array();
-        PQclear(res);
-        sendSuccess(root.dump());
-        return;
+        int last = pageRows - 1;
+        PostCursor next;
+        next.date = PgBinary::getTimestamp(res, last, PQfnumber(res, "date"));
+        next.id = static_cast<int>(PgBinary::getInteger(res, last, PQfnumber(res, "id")));
+        nextCursor = encodeCursor(next);
       }
 
-      root["fetchPosts"] = json::array();
-      for (int row = 0; row < rows; row++)
-      {
-        LivePostsModel::Post post = LivePostsModel::PG::Posts::fromPGRes(res, cols, row);
-        root["fetchPosts"].push_back(post);
-      }
+      // Rows go straight from the PGresult into the body, no Post model or json DOM per row
+      PgJson::RowWriter writer(res);
+      std::string body;
+      body.reserve(writer.estimate(0, pageRows) + nextCursor.size() + 32);
+      body += "{\"fetchPosts\":";
+      writer.appendArray(body, 0, pageRows);
+      body += ",\"nextCursor\":";
+      body += nextCursor.empty() ? "null" : "\"" + nextCursor + "\""; // base64url needs no escaping
+      body += '}';
       PQclear(res);
-      sendSuccess(root.dump());
+      res = nullptr;
+
+      std::string etag = strongETag(body);
+      Cache::postsCache().put(cacheKey_, cacheVersion_, body, etag);
+      sendSuccess(body, etag);
     }
     catch (const std::exception &e)
     {
-      PQclear(res);
+      if (res)
+        PQclear(res);
       sendError(e.what());
     }
   }
 
+  void FetchPostOp::finishFlight(Cache::FlightResult result)
+  {
+    if (!leading_)
+      return;
+    leading_ = false;
+    Cache::postsFlight().finish(flightKey_, std::make_shared<const Cache::FlightResult>(std::move(result)));
+  }
+
   // --- Local helpers (no DbOpBase) ---
   void FetchPostOp::sendError(const std::string &msg)
   {
+    finishFlight(Cache::FlightResult{msg, {}, {}});
     auto session = ctx_.session;
     auto &strand = session->strand();
     auto req = ctx_.req;
@@ -135,8 +298,9 @@ namespace Routes::LivePosts
         });
   }
 
-  void FetchPostOp::sendSuccess(const std::string &body)
+  void FetchPostOp::sendSuccess(const std::string &body, const std::string &etag)
   {
+    finishFlight(Cache::FlightResult{{}, body, etag});
     auto session = ctx_.session;
     auto &strand = session->strand();
     auto req = ctx_.req;
@@ -145,9 +309,10 @@ namespace Routes::LivePosts
         [self = shared_from_this(),
          send = std::move(send_),
          req = std::move(req),
-         body = std::move(body)]() mutable
+         body = std::move(body),
+         etag = std::move(etag)]() mutable
         {
-          send(success_request(req, body));
+          sendCompressed(self, self->ctx_.session->strand(), std::move(send), req, conditionalSuccess(req, body, etag));
         });
   }
 
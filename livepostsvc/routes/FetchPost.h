@@ -1,11 +1,16 @@
 #pragma once
 
+#include "Cursor.h"
+#include "ETag.h"
+#include "../cache/SingleFlight.h"
 #include "RouteCommon.h"
 #include "livepostsmodel/model.h"
 #include "apiserver/Session.h"
 #include "apiserver/PQClient.h"
 #include "apiserver/Response.h"
 #include "apiserver/HttpRoute.h"
+#include <cstdint>
+#include <optional>
 
 using Rest::RequestContext;
 using Rest::Response::bad_request;
@@ -23,14 +28,27 @@ namespace Routes::LivePosts
 
   protected:
     bool parseReq();
+    bool parseFields(const std::string &list);
+    std::string projectedSql() const;
     void doWork();
     void onWorkResult(PGresult *res);
 
     void sendError(const std::string &msg);
-    void sendSuccess(const std::string &body);
+    // 304 instead of body when If-None-Match already holds etag
+    void sendSuccess(const std::string &body, const std::string &etag);
+    // Hands the answer to requests that joined this one's query, when it leads
+    void finishFlight(Cache::FlightResult result);
 
   private:
     Rest::Parameters params_;
+    int limit_ = DEFAULT_LIMIT;
+    std::optional<PostCursor> cursor_;
+    std::vector<std::size_t> fields_; // ?fields= as POST_FIELDS indexes in table order, empty for all
+    std::string projectedSql_;        // pageSql/pageAfterSql narrowed to fields_
+    std::string cacheKey_;
+    std::uint64_t cacheVersion_ = 0;
+    std::string flightKey_; // cacheKey_@cacheVersion_
+    bool leading_ = false; // runs the query for postsFlight() followers
 
     RequestContext ctx_;
     Rest::AnySend send_;
@@ -40,6 +58,54 @@ namespace Routes::LivePosts
     std::vector<int> paramLengths_;
     std::vector<int> paramFormats_;
 
+  public:
+    static constexpr int DEFAULT_LIMIT = 50;
+    static constexpr int MAX_LIMIT = 100; // larger ?limit= is capped
+
+    // ?fields= allow-list: JSON name and its SELECT expression. id and date are always
+    // selected, the cursor needs them.
+    struct PostField
+    {
+      const char *name;
+      const char *select;
+    };
+    static constexpr PostField POST_FIELDS[] = {
+        {"id", "\"Posts\".\"id\""},
+        {"title", "\"title\""},
+        {"slug", "\"slug\""},
+        {"content", "\"content\""},
+        {"userId", "\"userId\""},
+        {"date", "\"date\""},
+        {"thumbsUp", "\"thumbsUp\""},
+        {"hooray", "\"hooray\""},
+        {"heart", "\"heart\""},
+        {"rocket", "\"rocket\""},
+        {"eyes", "\"eyes\""},
+        {"allocated", "\"allocated\""},
+        {"live", "\"live\""},
+        {"userName", "\"Users\".\"name\" AS \"userName\""},
+    };
+
+    // Newest first; one extra row tells whether there is a next page.
+    // ("date", id) keyset served by an index on ("live", "date" DESC, "id" DESC)
+    static constexpr const char *pageSql = "SELECT "
+                                           "\"Posts\".\"id\", \"title\", \"slug\", \"content\", \"userId\", \"date\", \"thumbsUp\", \"hooray\", \"heart\", \"rocket\", \"eyes\", "
+                                           "\"allocated\", \"live\", "
+                                           "\"Users\".\"name\" AS \"userName\" "
+                                           "FROM \"Posts\" LEFT JOIN \"Users\" ON \"Posts\".\"userId\" = \"Users\".\"id\" "
+                                           "WHERE \"live\"=$1 "
+                                           "ORDER BY \"date\" DESC, \"Posts\".\"id\" DESC "
+                                           "LIMIT $2;";
+    static constexpr const char *pageAfterSql = "SELECT "
+                                                "\"Posts\".\"id\", \"title\", \"slug\", \"content\", \"userId\", \"date\", \"thumbsUp\", \"hooray\", \"heart\", \"rocket\", \"eyes\", "
+                                                "\"allocated\", \"live\", "
+                                                "\"Users\".\"name\" AS \"userName\" "
+                                                "FROM \"Posts\" LEFT JOIN \"Users\" ON \"Posts\".\"userId\" = \"Users\".\"id\" "
+                                                "WHERE \"live\"=$1 AND (\"date\", \"Posts\".\"id\") < ($2, $3) "
+                                                "ORDER BY \"date\" DESC, \"Posts\".\"id\" DESC "
+                                                "LIMIT $4;";
+
+    // Every live post, unordered. Streamed by the --rebuild-site startup mode
     static constexpr const char *sql = "SELECT "
                                        "\"Posts\".\"id\", \"title\", \"slug\", \"content\", \"userId\", \"date\", \"thumbsUp\", \"hooray\", \"heart\", \"rocket\", \"eyes\", "
                                        "\"allocated\", \"live\", "
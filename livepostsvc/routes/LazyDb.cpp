@@ -0,0 +1,127 @@
+#include "LazyDb.h"
+#include "../metrics/Metrics.h"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace Routes
+{
+
+  static std::shared_ptr<Rest::PQClientPool> dbPool;
+
+  struct Replica
+  {
+    std::shared_ptr<Rest::PQClientPool> pool;
+    std::atomic<int> busy{0}; // borrowed plus being acquired
+  };
+
+  static std::vector<std::shared_ptr<Replica>> replicas;
+  static ReplicaSelect replicaSelect = ReplicaSelect::RoundRobin;
+  static std::chrono::milliseconds replicaWriteWindow{0};
+  static std::atomic<std::size_t> nextReplica{0};
+  static std::atomic<std::int64_t> lastWriteMs{0}; // steady clock, 0 = none yet
+
+  static std::int64_t nowMs()
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static Metrics::Counter &readsFrom(const char *target)
+  {
+    return Metrics::registry().counter("db_read_acquires_total", "Read-only connection acquisitions, by pool",
+                                       {{"pool", target}});
+  }
+
+  void setDbPool(std::shared_ptr<Rest::PQClientPool> pool)
+  {
+    dbPool = std::move(pool);
+  }
+
+  void acquireDb(std::function<void(std::shared_ptr<Rest::PQClient>)> ready)
+  {
+    if (!dbPool)
+    {
+      ready(nullptr);
+      return;
+    }
+    // Same acquisition RestServer performs for DbRequirement::Required routes
+    dbPool->async_acquire(std::move(ready));
+  }
+
+  void setReplicaPools(std::vector<std::shared_ptr<Rest::PQClientPool>> pools,
+                       ReplicaSelect select,
+                       std::chrono::milliseconds writeWindow)
+  {
+    replicas.clear();
+    for (auto &pool : pools)
+    {
+      auto replica = std::make_shared<Replica>();
+      replica->pool = std::move(pool);
+      replicas.push_back(std::move(replica));
+    }
+    replicaSelect = select;
+    replicaWriteWindow = writeWindow;
+  }
+
+  static std::shared_ptr<Replica> chooseReplica()
+  {
+    if (replicaSelect == ReplicaSelect::RoundRobin)
+      return replicas[nextReplica.fetch_add(1, std::memory_order_relaxed) % replicas.size()];
+
+    // Start the scan round robin so ties spread out
+    std::size_t start = nextReplica.fetch_add(1, std::memory_order_relaxed);
+    std::shared_ptr<Replica> best;
+    for (std::size_t i = 0; i < replicas.size(); i++)
+    {
+      auto &candidate = replicas[(start + i) % replicas.size()];
+      if (!best || candidate->busy.load(std::memory_order_relaxed) < best->busy.load(std::memory_order_relaxed))
+        best = candidate;
+    }
+    return best;
+  }
+
+  void acquireReadDb(std::function<void(std::shared_ptr<Rest::PQClient>)> ready)
+  {
+    static Metrics::Counter &fromPrimary = readsFrom("primary");
+    static Metrics::Counter &fromReplica = readsFrom("replica");
+
+    std::int64_t lastWrite = lastWriteMs.load(std::memory_order_relaxed);
+    bool recentWrite = lastWrite != 0 && nowMs() - lastWrite < replicaWriteWindow.count();
+    if (replicas.empty() || recentWrite)
+    {
+      fromPrimary.inc();
+      acquireDb(std::move(ready));
+      return;
+    }
+
+    auto replica = chooseReplica();
+    replica->busy.fetch_add(1, std::memory_order_relaxed);
+    replica->pool->async_acquire(
+        [replica, ready = std::move(ready)](std::shared_ptr<Rest::PQClient> client) mutable
+        {
+          if (!client)
+          {
+            replica->busy.fetch_sub(1, std::memory_order_relaxed);
+            fromPrimary.inc();
+            acquireDb(std::move(ready)); // replica down: the primary can still answer
+            return;
+          }
+          fromReplica.inc();
+          // Same client, but releasing the last copy also marks the replica less busy
+          ready(std::shared_ptr<Rest::PQClient>(client.get(),
+                                                [replica, client](Rest::PQClient *) mutable
+                                                {
+                                                  client.reset();
+                                                  replica->busy.fetch_sub(1, std::memory_order_relaxed);
+                                                }));
+        });
+  }
+
+  void markWrite()
+  {
+    lastWriteMs.store(nowMs(), std::memory_order_relaxed);
+  }
+
+}
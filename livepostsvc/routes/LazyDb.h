@@ -0,0 +1,40 @@
+#pragma once
+
+#include "apiserver/HttpRoute.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Routes
+{
+  // The pool RestServer hands out connections from; set once in main before run().
+  void setDbPool(std::shared_ptr<Rest::PQClientPool> pool);
+
+  // For routes registered with DbRequirement::None that only sometimes need the database
+  // (cache misses). ready gets a pooled connection, returned to the pool when the last copy
+  // is dropped, or nullptr when no pool is set or the pool could not connect.
+  void acquireDb(std::function<void(std::shared_ptr<Rest::PQClient>)> ready);
+
+  enum class ReplicaSelect
+  {
+    RoundRobin,
+    LeastBusy, // fewest connections borrowed or being acquired
+  };
+
+  // Read-only pools for acquireReadDb, set once in main before run(). None (the default)
+  // sends reads to the primary pool.
+  void setReplicaPools(std::vector<std::shared_ptr<Rest::PQClientPool>> pools,
+                       ReplicaSelect select,
+                       std::chrono::milliseconds writeWindow);
+
+  // acquireDb for queries that only read: a connection from a replica pool, or from the
+  // primary when there are no replicas, the chosen replica could not connect, or a write was
+  // marked within the write window.
+  void acquireReadDb(std::function<void(std::shared_ptr<Rest::PQClient>)> ready);
+
+  // A write committed on the primary. Reads stay on the primary for the write window, so a
+  // replica that replays it within the window does not answer (and seed the response caches)
+  // with older rows. Lag beyond the window can still do so; the cache TTLs bound how long.
+  void markWrite();
+}
@@ -0,0 +1,285 @@
+#include "PgBinary.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace Routes::PgBinary
+{
+
+  static constexpr std::int64_t MICROS_PER_SECOND = 1000000;
+  static constexpr std::int64_t MICROS_PER_DAY = 86400 * MICROS_PER_SECOND;
+  static constexpr std::int64_t PG_EPOCH_DAYS = 10957; // 2000-01-01 in days since 1970-01-01
+
+  static std::string bigEndian(std::uint64_t value, int bytes)
+  {
+    std::string out(static_cast<std::size_t>(bytes), '\0');
+    for (int i = bytes - 1; i >= 0; i--)
+    {
+      out[static_cast<std::size_t>(i)] = static_cast<char>(value & 0xff);
+      value >>= 8;
+    }
+    return out;
+  }
+
+  static std::uint64_t readBigEndian(const char *bytes, int count)
+  {
+    std::uint64_t value = 0;
+    for (int i = 0; i < count; i++)
+      value = value << 8 | static_cast<unsigned char>(bytes[i]);
+    return value;
+  }
+
+  std::string encodeInt4(std::int32_t value)
+  {
+    return bigEndian(static_cast<std::uint32_t>(value), 4);
+  }
+
+  std::string encodeInt8(std::int64_t value)
+  {
+    return bigEndian(static_cast<std::uint64_t>(value), 8);
+  }
+
+  std::string encodeBool(bool value)
+  {
+    return std::string(1, value ? '\1' : '\0');
+  }
+
+  std::string encodeTimestamp(std::int64_t micros)
+  {
+    return encodeInt8(micros);
+  }
+
+  std::int16_t decodeInt2(const char *bytes)
+  {
+    return static_cast<std::int16_t>(readBigEndian(bytes, 2));
+  }
+
+  std::int32_t decodeInt4(const char *bytes)
+  {
+    return static_cast<std::int32_t>(readBigEndian(bytes, 4));
+  }
+
+  std::int64_t decodeInt8(const char *bytes)
+  {
+    return static_cast<std::int64_t>(readBigEndian(bytes, 8));
+  }
+
+  bool decodeBool(const char *bytes)
+  {
+    return bytes[0] != 0;
+  }
+
+  std::int64_t decodeTimestamp(const char *bytes)
+  {
+    return decodeInt8(bytes);
+  }
+
+  // Proleptic Gregorian <-> days since 1970-01-01 (H. Hinnant's civil date algorithms)
+  static std::int64_t daysFromCivil(std::int64_t y, unsigned m, unsigned d)
+  {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+  }
+
+  static void civilFromDays(std::int64_t z, std::int64_t &y, unsigned &m, unsigned &d)
+  {
+    z += 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+  }
+
+  static bool digits(std::string_view text, std::size_t pos, std::size_t count, int &out)
+  {
+    if (pos + count > text.size())
+      return false;
+    out = 0;
+    for (std::size_t i = pos; i < pos + count; i++)
+    {
+      if (text[i] < '0' || text[i] > '9')
+        return false;
+      out = out * 10 + (text[i] - '0');
+    }
+    return true;
+  }
+
+  std::optional<std::int64_t> parseTimestamp(std::string_view text)
+  {
+    int year, month, day, hour, minute, second;
+    if (!digits(text, 0, 4, year) || text.size() < 19 || text[4] != '-' || !digits(text, 5, 2, month) ||
+        text[7] != '-' || !digits(text, 8, 2, day) || (text[10] != ' ' && text[10] != 'T') ||
+        !digits(text, 11, 2, hour) || text[13] != ':' || !digits(text, 14, 2, minute) ||
+        text[16] != ':' || !digits(text, 17, 2, second))
+      return std::nullopt;
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+      return std::nullopt;
+
+    std::size_t pos = 19;
+    std::int64_t fraction = 0;
+    if (pos < text.size() && text[pos] == '.')
+    {
+      std::int64_t scale = MICROS_PER_SECOND;
+      pos++;
+      while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+      {
+        scale /= 10;
+        fraction += (text[pos] - '0') * scale; // digits past microseconds add 0
+        pos++;
+      }
+    }
+
+    std::int64_t offsetSeconds = 0;
+    if (pos < text.size() && (text[pos] == '+' || text[pos] == '-'))
+    {
+      int sign = text[pos] == '-' ? -1 : 1;
+      int offsetHours, offsetMinutes = 0;
+      if (!digits(text, pos + 1, 2, offsetHours))
+        return std::nullopt;
+      pos += 3;
+      if (pos < text.size() && text[pos] == ':')
+      {
+        if (!digits(text, pos + 1, 2, offsetMinutes))
+          return std::nullopt;
+        pos += 3;
+      }
+      offsetSeconds = sign * (offsetHours * 3600 + offsetMinutes * 60);
+    }
+    else if (pos < text.size() && text[pos] == 'Z')
+    {
+      pos++;
+    }
+    if (pos != text.size())
+      return std::nullopt;
+
+    std::int64_t days = daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) - PG_EPOCH_DAYS;
+    std::int64_t seconds = days * 86400 + hour * 3600 + minute * 60 + second - offsetSeconds;
+    return seconds * MICROS_PER_SECOND + fraction;
+  }
+
+  static void appendDigits(std::string &out, std::int64_t value, int width)
+  {
+    char buffer[8];
+    for (int i = width - 1; i >= 0; i--)
+    {
+      buffer[i] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    }
+    out.append(buffer, static_cast<std::size_t>(width));
+  }
+
+  // "YYYY-MM-DD<separator>HH:MM:SS.<fraction>", fraction in milliseconds or microseconds
+  static void appendTimestamp(std::string &out, std::int64_t micros, char separator, bool fullMicros)
+  {
+    std::int64_t days = micros / MICROS_PER_DAY;
+    std::int64_t inDay = micros % MICROS_PER_DAY;
+    if (inDay < 0)
+    {
+      inDay += MICROS_PER_DAY;
+      days--;
+    }
+
+    std::int64_t year;
+    unsigned month, day;
+    civilFromDays(days + PG_EPOCH_DAYS, year, month, day);
+    std::int64_t seconds = inDay / MICROS_PER_SECOND;
+
+    appendDigits(out, year, 4);
+    out += '-';
+    appendDigits(out, month, 2);
+    out += '-';
+    appendDigits(out, day, 2);
+    out += separator;
+    appendDigits(out, seconds / 3600, 2);
+    out += ':';
+    appendDigits(out, seconds / 60 % 60, 2);
+    out += ':';
+    appendDigits(out, seconds % 60, 2);
+    out += '.';
+    if (fullMicros)
+      appendDigits(out, inDay % MICROS_PER_SECOND, 6);
+    else
+      appendDigits(out, inDay % MICROS_PER_SECOND / 1000, 3);
+  }
+
+  void appendIsoTimestamp(std::string &out, std::int64_t micros)
+  {
+    appendTimestamp(out, micros, 'T', false);
+    out += 'Z';
+  }
+
+  std::string toText(Oid type, const char *bytes, int length)
+  {
+    switch (type)
+    {
+    case BOOLOID:
+      return decodeBool(bytes) ? "true" : "false";
+    case INT2OID:
+      return std::to_string(decodeInt2(bytes));
+    case INT4OID:
+    case OIDOID:
+      return std::to_string(decodeInt4(bytes));
+    case INT8OID:
+      return std::to_string(decodeInt8(bytes));
+    case TEXTOID:
+      return std::string(bytes, static_cast<std::size_t>(length)); // binary text is the raw bytes
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID:
+    {
+      std::string out;
+      appendTimestamp(out, decodeTimestamp(bytes), ' ', true);
+      out += "+00";
+      return out;
+    }
+    default:
+      throw std::invalid_argument("No text form for binary parameter of type " + std::to_string(type));
+    }
+  }
+
+  std::int64_t getInteger(const PGresult *res, int row, int col)
+  {
+    if (PQgetisnull(res, row, col))
+      throw std::runtime_error(std::string("NULL in column ") + PQfname(res, col));
+
+    const char *value = PQgetvalue(res, row, col);
+    if (PQfformat(res, col) == 0)
+      return std::stoll(value);
+
+    switch (PQftype(res, col))
+    {
+    case INT2OID:
+      return decodeInt2(value);
+    case INT4OID:
+    case OIDOID:
+      return decodeInt4(value);
+    case INT8OID:
+      return decodeInt8(value);
+    default:
+      throw std::runtime_error(std::string("Column is not an integer: ") + PQfname(res, col));
+    }
+  }
+
+  std::int64_t getTimestamp(const PGresult *res, int row, int col)
+  {
+    if (PQgetisnull(res, row, col))
+      throw std::runtime_error(std::string("NULL in column ") + PQfname(res, col));
+
+    const char *value = PQgetvalue(res, row, col);
+    if (PQfformat(res, col) == 1)
+      return decodeTimestamp(value);
+
+    auto micros = parseTimestamp(std::string_view(value, static_cast<std::size_t>(PQgetlength(res, row, col))));
+    if (!micros)
+      throw std::runtime_error(std::string("Unreadable timestamp in column ") + PQfname(res, col));
+    return *micros;
+  }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <libpq-fe.h>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Postgres binary wire format (format 1) for the types the hot queries bind and read.
+// Values are big endian; timestamp and timestamptz are both int64 microseconds since
+// 2000-01-01 00:00:00 UTC.
+namespace Routes::PgBinary
+{
+  // pg_type OIDs
+  inline constexpr Oid BOOLOID = 16;
+  inline constexpr Oid INT8OID = 20;
+  inline constexpr Oid INT2OID = 21;
+  inline constexpr Oid INT4OID = 23;
+  inline constexpr Oid TEXTOID = 25;
+  inline constexpr Oid OIDOID = 26;
+  inline constexpr Oid TIMESTAMPOID = 1114;
+  inline constexpr Oid TIMESTAMPTZOID = 1184;
+
+  // Parameter encoders: the returned bytes go in paramStrings_ with the length set and format 1.
+  // Text parameters need no encoder, their binary form is the raw bytes.
+  std::string encodeInt4(std::int32_t value);
+  std::string encodeInt8(std::int64_t value);
+  std::string encodeBool(bool value);
+  std::string encodeTimestamp(std::int64_t micros);
+
+  // Result decoders, for a field whose PQfformat is 1
+  std::int16_t decodeInt2(const char *bytes);
+  std::int32_t decodeInt4(const char *bytes);
+  std::int64_t decodeInt8(const char *bytes);
+  bool decodeBool(const char *bytes);
+  std::int64_t decodeTimestamp(const char *bytes);
+
+  // Text form fallbacks: "YYYY-MM-DD HH:MM:SS[.ffffff][+HH[:MM]]" as Postgres prints it with
+  // DateStyle ISO. nullopt for infinity or anything else it cannot read.
+  std::optional<std::int64_t> parseTimestamp(std::string_view text);
+
+  // "YYYY-MM-DDTHH:MM:SS.mmmZ", the form the model serializes dates in
+  void appendIsoTimestamp(std::string &out, std::int64_t micros);
+
+  // Text form of a binary (format 1) value of type, as Postgres would accept it in a literal.
+  // Timestamps keep microseconds and carry "+00", which a timestamp without time zone ignores.
+  // Throws std::invalid_argument for a type without a decoder here.
+  std::string toText(Oid type, const char *bytes, int length);
+
+  // A field of either format as an integer or timestamp; throws std::runtime_error when the
+  // value is NULL or unreadable
+  std::int64_t getInteger(const PGresult *res, int row, int col);
+  std::int64_t getTimestamp(const PGresult *res, int row, int col);
+}
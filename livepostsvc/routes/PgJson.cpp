@@ -0,0 +1,220 @@
+#include "PgJson.h"
+#include "PgBinary.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace Routes::PgJson
+{
+  using namespace PgBinary; // OIDs and binary decoders
+
+  static ColumnKind kindOf(Oid type)
+  {
+    switch (type)
+    {
+    case INT2OID:
+    case INT4OID:
+    case INT8OID:
+    case OIDOID:
+      return ColumnKind::Number;
+    case BOOLOID:
+      return ColumnKind::Boolean;
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID:
+      return ColumnKind::Timestamp;
+    default:
+      return ColumnKind::String;
+    }
+  }
+
+  void appendEscaped(std::string &out, std::string_view text)
+  {
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::size_t clean = 0; // start of the run not yet copied
+    for (std::size_t i = 0; i < text.size(); i++)
+    {
+      unsigned char c = static_cast<unsigned char>(text[i]);
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+
+      out.append(text.data() + clean, i - clean);
+      clean = i + 1;
+      switch (c)
+      {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\b':
+        out += "\\b";
+        break;
+      case '\f':
+        out += "\\f";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        out += "\\u00";
+        out += HEX[c >> 4];
+        out += HEX[c & 15];
+      }
+    }
+    out.append(text.data() + clean, text.size() - clean);
+  }
+
+  // Prisma DateTime columns are timestamp(3) in UTC: emit the ISO form the model serializes
+  static void appendTimestamp(std::string &out, std::string_view text)
+  {
+    // timestamptz prints a "+00" offset; the session is expected to run in UTC
+    auto offset = text.find_first_of("+-", 10);
+    if (offset != std::string_view::npos)
+      text = text.substr(0, offset);
+
+    out += '"';
+    if (text.size() >= 19 && text[10] == ' ')
+    {
+      out.append(text.data(), 10);
+      out += 'T';
+      out.append(text.data() + 11, 8); // HH:MM:SS
+      // Fraction padded or cut to milliseconds
+      std::string_view fraction = text.size() > 20 && text[19] == '.' ? text.substr(20) : std::string_view();
+      out += '.';
+      for (std::size_t i = 0; i < 3; i++)
+        out += i < fraction.size() ? fraction[i] : '0';
+      out += 'Z';
+    }
+    else
+    {
+      appendEscaped(out, text); // infinity or an unexpected DateStyle
+    }
+    out += '"';
+  }
+
+  RowWriter::RowWriter(const PGresult *res)
+      : res_(res)
+  {
+    int fields = PQnfields(res);
+    columns_.reserve(fields);
+    for (int i = 0; i < fields; i++)
+    {
+      Column column{i, kindOf(PQftype(res, i)), PQftype(res, i), PQfformat(res, i) == 1, {}};
+      column.key += '"';
+      appendEscaped(column.key, PQfname(res, i));
+      column.key += "\":";
+      keyBytes_ += column.key.size() + 1; // plus the comma
+      columns_.push_back(std::move(column));
+    }
+    // nlohmann::json objects are std::map backed, dump() writes keys in byte order
+    std::sort(columns_.begin(), columns_.end(), [res](const Column &a, const Column &b)
+              { return std::string_view(PQfname(res, a.index)) < std::string_view(PQfname(res, b.index)); });
+  }
+
+  std::size_t RowWriter::estimate(int begin, int end) const
+  {
+    std::size_t bytes = 2;
+    for (int row = begin; row < end; row++)
+    {
+      bytes += keyBytes_ + 2 + 1; // braces and comma
+      for (const auto &column : columns_)
+      {
+        // Quotes, timestamp reshaping, and a little room for escapes
+        bytes += static_cast<std::size_t>(PQgetlength(res_, row, column.index)) + 8;
+      }
+    }
+    return bytes;
+  }
+
+  void RowWriter::appendArray(std::string &out, int begin, int end) const
+  {
+    out += '[';
+    for (int row = begin; row < end; row++)
+    {
+      if (row != begin)
+        out += ',';
+      appendRow(out, row);
+    }
+    out += ']';
+  }
+
+  void RowWriter::appendBinary(std::string &out, const Column &column, const char *value)
+  {
+    switch (column.kind)
+    {
+    case ColumnKind::Number:
+    {
+      std::int64_t number = column.type == INT2OID   ? decodeInt2(value)
+                            : column.type == INT8OID ? decodeInt8(value)
+                                                     : decodeInt4(value);
+      char buffer[24];
+      auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), number);
+      out.append(buffer, end);
+      break;
+    }
+    case ColumnKind::Boolean:
+      out += decodeBool(value) ? "true" : "false";
+      break;
+    case ColumnKind::Timestamp:
+      out += '"';
+      appendIsoTimestamp(out, decodeTimestamp(value));
+      out += '"';
+      break;
+    case ColumnKind::String:
+      break; // text columns are the raw bytes in either format
+    }
+  }
+
+  void RowWriter::appendRow(std::string &out, int row) const
+  {
+    out += '{';
+    bool first = true;
+    for (const auto &column : columns_)
+    {
+      if (!first)
+        out += ',';
+      first = false;
+      out += column.key;
+
+      if (PQgetisnull(res_, row, column.index))
+      {
+        out += "null";
+        continue;
+      }
+
+      std::string_view value(PQgetvalue(res_, row, column.index),
+                             static_cast<std::size_t>(PQgetlength(res_, row, column.index)));
+      if (column.binary && column.kind != ColumnKind::String)
+      {
+        appendBinary(out, column, value.data());
+        continue;
+      }
+      switch (column.kind)
+      {
+      case ColumnKind::Number:
+        out += value;
+        break;
+      case ColumnKind::Boolean:
+        out += value == "t" ? "true" : "false";
+        break;
+      case ColumnKind::Timestamp:
+        appendTimestamp(out, value);
+        break;
+      case ColumnKind::String:
+        out += '"';
+        appendEscaped(out, value);
+        out += '"';
+        break;
+      }
+    }
+    out += '}';
+  }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <libpq-fe.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Routes::PgJson
+{
+  // How a column's value is written, from PQftype. Text and binary (PQfformat 1) results
+  // give the same JSON.
+  enum class ColumnKind
+  {
+    Number,    // int2/int4/int8/oid: copied unquoted
+    Boolean,   // 't'/'f' -> true/false
+    Timestamp, // "YYYY-MM-DD HH:MM:SS.fff" -> "YYYY-MM-DDTHH:MM:SS.fffZ"
+    String,    // everything else, quoted and escaped
+  };
+
+  // Writes rows straight from PQgetvalue into one buffer, skipping the model struct and
+  // json DOM. Keys are the column names in the order nlohmann::json::dump() writes them
+  // (sorted), strings escaped the same way, NULL as null.
+  class RowWriter
+  {
+  public:
+    explicit RowWriter(const PGresult *res);
+
+    // Upper bound on the bytes rows [begin, end) need, for out.reserve()
+    std::size_t estimate(int begin, int end) const;
+
+    // Appends [row, row, ...] for rows [begin, end)
+    void appendArray(std::string &out, int begin, int end) const;
+    void appendRow(std::string &out, int row) const;
+
+  private:
+    struct Column
+    {
+      int index;
+      ColumnKind kind;
+      Oid type;
+      bool binary;
+      std::string key; // "\"name\":"
+    };
+
+    static void appendBinary(std::string &out, const Column &column, const char *value);
+
+    const PGresult *res_;
+    std::vector<Column> columns_; // in key order
+    std::size_t keyBytes_ = 0;
+  };
+
+  // nlohmann::json escaping (control characters as \u00xx, UTF-8 passed through)
+  void appendEscaped(std::string &out, std::string_view text);
+}
@@ -5,8 +5,11 @@
 #include "CreatePost.h"
 #include "FetchAuthor.h"
 #include "FetchPost.h"
+#include "LazyDb.h"
 #include "RouteCommon.h"
 #include "StagePost.h"
+#include "../metrics/Metrics.h"
+#include "../prerender/Jobs.h"
 #include <boost/asio/dispatch.hpp>
 
 using Rest::RequestContext;
@@ -16,16 +19,38 @@ namespace Routes
 {
   namespace LivePosts
   {
+    // Registered with DbRequirement::None: checks that a read connection (a replica when
+    // there are any) can be borrowed
     inline void healthCheck(RequestContext ctx)
     {
-      json root = "OK";
-      std::string result = root.dump();
+      auto context = std::make_shared<RequestContext>(std::move(ctx));
+      acquireReadDb([context](std::shared_ptr<Rest::PQClient> db)
+                    {
+                      auto &strand = context->session->strand(); // <-- bind reference ONCE
+                      net::dispatch(strand,
+                                    [context, ok = db != nullptr]() mutable
+                                    {
+                                      if (!ok)
+                                      {
+                                        context->send(Rest::Response::bad_request(context->req, "No database connection"));
+                                        return;
+                                      }
+                                      json root = "OK";
+                                      context->send(Rest::Response::success_request(context->req, root.dump()));
+                                    }); });
+    };
+
+    inline void metrics(RequestContext ctx)
+    {
+      std::string result = Metrics::registry().render();
       auto &strand = ctx.session->strand(); // <-- bind reference ONCE
 
       net::dispatch(strand,
                     [ctx = std::move(ctx), result = std::move(result)]() mutable
                     {
-                      ctx.send(Rest::Response::success_request(ctx.req, result));
+                      auto res = Rest::Response::success_request(ctx.req, result);
+                      res.set(http::field::content_type, "text/plain; version=0.0.4");
+                      ctx.send(std::move(res));
                     });
     };
 
@@ -47,6 +72,48 @@ namespace Routes
       op->start();
     }
 
+    inline void stageJob(RequestContext ctx)
+    {
+      auto &strand = ctx.session->strand(); // <-- bind reference ONCE
+
+      std::uint64_t jobId = 0;
+      try
+      {
+        jobId = std::stoull(ctx.session->getReqUrlParameters()["id"]);
+      }
+      catch (...)
+      {
+        net::dispatch(strand,
+                      [ctx = std::move(ctx)]() mutable
+                      {
+                        ctx.send(Rest::Response::bad_request(ctx.req, "Invalid stage job id"));
+                      });
+        return;
+      }
+
+      auto job = Prerender::jobs().find(jobId);
+      if (!job)
+      {
+        net::dispatch(strand,
+                      [ctx = std::move(ctx)]() mutable
+                      {
+                        auto res = Rest::Response::bad_request(ctx.req, "Stage job not found");
+                        res.result(http::status::not_found);
+                        ctx.send(std::move(res));
+                      });
+        return;
+      }
+
+      json root;
+      root["stageJob"] = *job;
+      std::string result = root.dump();
+      net::dispatch(strand,
+                    [ctx = std::move(ctx), result = std::move(result)]() mutable
+                    {
+                      ctx.send(Rest::Response::success_request(ctx.req, result));
+                    });
+    }
+
     inline void createAuthor(RequestContext ctx)
     {
       auto op = std::make_shared<CreateAuthorOp>(std::move(ctx));
@@ -1,4 +1,9 @@
 #include "StagePost.h"
+#include "Compression.h"
+#include "LazyDb.h"
+#include "Statements.h"
+#include "PgBinary.h"
+#include "../cache/ResponseCache.h"
 
 #include "apiserver/Session.h"
 #include "apiserver/PQClient.h"
@@ -8,7 +13,7 @@
 #include <mtlog/mt_log.hpp>
 #include "livepostsmodel/pq.h"
 #include "slugger.h"
-#include "../prerender/Prerender.h"
+#include "../prerender/Pipeline.h"
 
 using json = nlohmann::json;
 using Rest::RouteHandler;
@@ -32,6 +37,10 @@ namespace Routes::LivePosts
 
   bool StagePostOp::parseReq()
   {
+    auto [route_url, query_params] = RouteHandler::parse_query_params(std::string(ctx_.req.target()));
+    auto asyncParam = query_params.find("async");
+    async_ = asyncParam != query_params.end() && (asyncParam->second == "true" || asyncParam->second == "1");
+
     try
     {
       stagePostInput_ = json::parse(ctx_.req.body());
@@ -51,20 +60,21 @@ namespace Routes::LivePosts
     std::string slug = slugger::make_slug(stagePostInput_.title, std::to_string(stagePostInput_.postId), 30);
     std::cout << slug << "\n";
 
-    // Build paramStrings_ (owned)
+    // Build paramStrings_ (owned), binary: bool live, text slug, int4 id
     paramStrings_.clear();
-    paramStrings_.push_back(std::to_string(stagePostInput_.live));
+    paramStrings_.push_back(PgBinary::encodeBool(stagePostInput_.live));
     paramStrings_.push_back(slug);
-    paramStrings_.push_back(std::to_string(stagePostInput_.postId));
+    paramStrings_.push_back(PgBinary::encodeInt4(stagePostInput_.postId));
 
-    // Build paramValues_
+    // Build paramValues_ + lengths (binary values may hold zero bytes)
     paramValues_.clear();
+    paramLengths_.clear();
     for (auto &s : paramStrings_)
-      paramValues_.push_back(s.c_str());
-
-    // lengths + formats
-    paramLengths_.assign(paramStrings_.size(), 0);
-    paramFormats_.assign(paramStrings_.size(), 0);
+    {
+      paramValues_.push_back(s.data());
+      paramLengths_.push_back(static_cast<int>(s.size()));
+    }
+    paramFormats_.assign(paramStrings_.size(), 1);
 
     return true;
   }
@@ -72,12 +82,12 @@ namespace Routes::LivePosts
   void StagePostOp::doWork()
   {
     auto self = shared_from_this();
-    ctx_.db->asyncExecParams(
-        sql,
+    Statements::exec(
+        *ctx_.db,
+        Statements::Id::StagePost,
         paramValues_,
         paramLengths_,
         paramFormats_,
-        static_cast<int>(paramValues_.size()),
         [self](PGresult *res)
         { self->onWorkResult(res); });
   }
@@ -120,6 +130,7 @@ namespace Routes::LivePosts
       {
         root["stagePost"] = "No rows returned from query";
         PQclear(res);
+        res = nullptr;
         sendSuccess(root.dump());
         return;
       }
@@ -127,9 +138,68 @@ namespace Routes::LivePosts
       // Only one row is returned
       updatedPostStage_ = LivePostsModel::PG::Posts::fromPGRes(res, cols, 0);
       PQclear(res);
+      res = nullptr; // the catch below must not clear it again
+      Cache::postsCache().bump(); // live/title/content changed for GET /posts
+      markWrite();
+      // The render keeps this op alive; hand the connection back to the pool now, not after the swap
+      ctx_.db.reset();
 
+      // Render on the prerender executor, resume on the session strand
       json jsonPost = updatedPostStage_;
-      Prerender::prerenderPost(jsonPost.dump());
+      if (async_)
+      {
+        jobId_ = Prerender::jobs().create(updatedPostStage_.id, updatedPostStage_.slug);
+      }
+      auto self = shared_from_this();
+      Prerender::asyncPrerenderPost(
+          updatedPostStage_.id,
+          jsonPost.dump(),
+          ctx_.session->strand(),
+          [self](const std::string &error)
+          { self->onPrerendered(error); },
+          jobId_);
+
+      if (async_)
+      {
+        // The update is committed and the render queued; the caller polls the stage job route
+        root["stagePost"] = updatedPostStage_;
+        auto job = Prerender::jobs().find(jobId_); // may already be evicted past MAX_JOBS
+        root["stageJob"] = job ? json(*job) : json{{"id", jobId_}};
+        sendAccepted(root.dump());
+      }
+    }
+    catch (const std::string &e)
+    {
+      if (res)
+        PQclear(res);
+      sendError(e);
+    }
+    catch (const std::exception &e)
+    {
+      if (res)
+        PQclear(res);
+      sendError(e.what());
+    }
+  }
+
+  void StagePostOp::onPrerendered(const std::string &error)
+  {
+    if (!error.empty())
+    {
+      if (async_)
+      {
+        mt_logging::logger().log({fmt::format("Stage job {} post {} failed: {}", jobId_, updatedPostStage_.id, error),
+                                  mt_logging::LogLevel::Error,
+                                  true});
+        return; // already answered 202, failure is reported by the stage job route
+      }
+      sendError(error);
+      return;
+    }
+
+    try
+    {
+      json root;
       root["stagePost"] = updatedPostStage_;
 
       LivePostsEvents::PostStageEvent event;
@@ -140,17 +210,18 @@ namespace Routes::LivePosts
           std::getenv("REDIS_GATEWAY_CHANNEL") == nullptr ? "ws_events" : std::getenv("REDIS_GATEWAY_CHANNEL"),
           jsonEvent.dump());
 
-      sendSuccess(root.dump());
+      if (!async_)
+        sendSuccess(root.dump());
     }
     catch (const std::string &e)
     {
-      PQclear(res);
-      sendError(e);
+      if (!async_)
+        sendError(e);
     }
     catch (const std::exception &e)
     {
-      PQclear(res);
-      sendError(e.what());
+      if (!async_)
+        sendError(e.what());
     }
   }
 
@@ -183,7 +254,25 @@ namespace Routes::LivePosts
          req = std::move(req),
          body = std::move(body)]() mutable
         {
-          send(success_request(req, body));
+          sendCompressed(self, self->ctx_.session->strand(), std::move(send), req, success_request(req, body));
+        });
+  }
+
+  void StagePostOp::sendAccepted(const std::string &body)
+  {
+    auto session = ctx_.session;
+    auto &strand = session->strand();
+    auto req = ctx_.req;
+    net::dispatch(
+        strand,
+        [self = shared_from_this(),
+         send = std::move(send_),
+         req = std::move(req),
+         body = std::move(body)]() mutable
+        {
+          auto res = success_request(req, body);
+          res.result(http::status::accepted);
+          send(std::move(res));
         });
   }
 }
\ No newline at end of file
@@ -25,13 +25,17 @@ namespace Routes::LivePosts
     bool parseReq();
     void doWork();
     void onWorkResult(PGresult *res);
+    void onPrerendered(const std::string &error);
 
     void sendError(const std::string &msg);
     void sendSuccess(const std::string &body);
+    void sendAccepted(const std::string &body);
 
   private:
     LivePostsModel::PostStage stagePostInput_;
     LivePostsModel::Post updatedPostStage_;
+    bool async_ = false; // ?async=true: reply 202 with a stage job id before rendering
+    std::uint64_t jobId_ = 0;
 
     RequestContext ctx_;
     Rest::AnySend send_;
@@ -41,6 +45,8 @@ namespace Routes::LivePosts
     std::vector<int> paramLengths_;
     std::vector<int> paramFormats_;
 
+  public:
+    // Registered in Routes::Statements
     static constexpr const char *sql =
         "UPDATE \"Posts\" "
         "SET \"live\"=$1, "
@@ -0,0 +1,264 @@
+#include "Statements.h"
+#include "CreateAuthor.h"
+#include "CreatePost.h"
+#include "FetchAuthor.h"
+#include "FetchPost.h"
+#include "PgBinary.h"
+#include "StagePost.h"
+#include "../metrics/Metrics.h"
+#include <mtlog/mt_log.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace Routes::Statements
+{
+
+  const std::vector<Statement> &all()
+  {
+    using namespace PgBinary;
+    static const std::vector<Statement> statements = {
+        {Id::CreatePost, "create_post", LivePosts::CreatePostOp::createPostSql, {TEXTOID, TEXTOID, INT4OID, BOOLOID}},
+        {Id::CreateAuthor, "create_author", LivePosts::CreateAuthorOp::sql, {TEXTOID, TEXTOID}},
+        {Id::FetchPostsPage, "fetch_posts_page", LivePosts::FetchPostOp::pageSql, {BOOLOID, INT8OID}},
+        {Id::FetchPostsPageAfter, "fetch_posts_page_after", LivePosts::FetchPostOp::pageAfterSql, {BOOLOID, TIMESTAMPTZOID, INT4OID, INT8OID}},
+        {Id::StagePost, "stage_post", LivePosts::StagePostOp::sql, {BOOLOID, TEXTOID, INT4OID}},
+        {Id::FetchAuthor, "fetch_author", LivePosts::FetchAuthorOp::sql, {TEXTOID}},
+    };
+    return statements;
+  }
+
+  const Statement &get(Id id)
+  {
+    for (const auto &statement : all())
+    {
+      if (statement.id == id)
+        return statement;
+    }
+    throw std::out_of_range("Unknown statement");
+  }
+
+  static std::size_t indexOf(const Statement &statement)
+  {
+    return static_cast<std::size_t>(&statement - all().data());
+  }
+
+  struct StatementMetrics
+  {
+    Metrics::Counter *prepared;
+    Metrics::Counter *unnamed;
+    Metrics::Counter *prepares;
+  };
+
+  static StatementMetrics &metrics(const Statement &statement)
+  {
+    // One set per statement, looked up once
+    static std::vector<StatementMetrics> counters = []
+    {
+      std::vector<StatementMetrics> out;
+      for (const auto &s : all())
+      {
+        auto &registry = Metrics::registry();
+        out.push_back({&registry.counter("pg_statement_calls_total", "Route queries sent, by statement",
+                                         {{"statement", s.name}, {"prepared", "true"}}),
+                       &registry.counter("pg_statement_calls_total", "Route queries sent, by statement",
+                                         {{"statement", s.name}, {"prepared", "false"}}),
+                       &registry.counter("pg_statement_prepares_total", "PREPAREs sent, by statement",
+                                         {{"statement", s.name}})});
+      }
+      return out;
+    }();
+    return counters[indexOf(statement)];
+  }
+
+  // Which statements each connection has prepared, one bit per statement. Keyed by address:
+  // a PQClient that reconnects, or a new one at a freed address, is caught by SQLSTATE 26000.
+  static std::mutex preparedMutex;
+  static std::unordered_map<const Rest::PQClient *, std::uint64_t> preparedBits;
+  static constexpr std::size_t MAX_CLIENTS = 1024; // addresses of closed clients pile up
+
+  static bool isPrepared(const Rest::PQClient &db, const Statement &statement)
+  {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    auto it = preparedBits.find(&db);
+    return it != preparedBits.end() && (it->second >> indexOf(statement) & 1);
+  }
+
+  static void setPrepared(const Rest::PQClient &db, const Statement &statement, bool prepared)
+  {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    if (prepared && preparedBits.size() >= MAX_CLIENTS && !preparedBits.contains(&db))
+      preparedBits.clear(); // cheap bound; live connections answer 42P05 and are marked again
+    auto bit = std::uint64_t{1} << indexOf(statement);
+    if (prepared)
+      preparedBits[&db] |= bit;
+    else if (auto it = preparedBits.find(&db); it != preparedBits.end())
+      it->second &= ~bit;
+  }
+
+  static bool hasSqlState(const PGresult *res, const char *state)
+  {
+    const char *field = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+    return field && std::strcmp(field, state) == 0;
+  }
+
+  // $tag$value$tag$ with a tag the value does not contain; needs no escaping at all
+  static void appendQuoted(std::string &out, const std::string &value)
+  {
+    std::string tag = "$p$";
+    for (int n = 0; value.find(tag) != std::string::npos; n++)
+      tag = "$p" + std::to_string(n) + "$";
+    out += tag;
+    out += value;
+    out += tag;
+  }
+
+  static std::string executeSql(const Statement &statement,
+                                const std::vector<const char *> &values,
+                                const std::vector<int> &lengths,
+                                const std::vector<int> &formats)
+  {
+    if (values.size() != statement.types.size())
+      throw std::invalid_argument(std::string("Wrong parameter count for statement ") + statement.name);
+
+    std::string sql = "EXECUTE ";
+    sql += statement.name;
+    if (values.empty())
+      return sql;
+
+    sql += '(';
+    for (std::size_t i = 0; i < values.size(); i++)
+    {
+      if (i > 0)
+        sql += ", ";
+      if (!values[i])
+      {
+        sql += "NULL";
+        continue;
+      }
+      bool binary = i < formats.size() && formats[i] == 1;
+      appendQuoted(sql, binary ? PgBinary::toText(statement.types[i], values[i], lengths[i]) : std::string(values[i]));
+    }
+    sql += ')';
+    return sql;
+  }
+
+  static void execUnnamed(Rest::PQClient &db, const Statement &statement, const char *sql,
+                          const std::vector<const char *> &values,
+                          const std::vector<int> &lengths,
+                          const std::vector<int> &formats,
+                          std::function<void(PGresult *)> done)
+  {
+    metrics(statement).unnamed->inc();
+    db.asyncExecParams(sql, values, lengths, formats, static_cast<int>(values.size()), std::move(done));
+  }
+
+  struct PreparedCall
+  {
+    Rest::PQClient *db;
+    const Statement *statement;
+    std::string execute;
+    std::function<void(PGresult *)> done;
+    // Kept for the unnamed fallback when PREPARE fails; the op keeps its arrays alive
+    const std::vector<const char *> *values;
+    const std::vector<int> *lengths;
+    const std::vector<int> *formats;
+    bool retried = false;
+  };
+
+  static void execute(std::shared_ptr<PreparedCall> call);
+
+  static void prepare(std::shared_ptr<PreparedCall> call)
+  {
+    static const std::vector<const char *> none;
+    static const std::vector<int> noInts;
+
+    metrics(*call->statement).prepares->inc();
+    auto sql = std::make_shared<std::string>(std::string("PREPARE ") + call->statement->name + " AS " + call->statement->sql);
+    call->db->asyncExecParams(sql->c_str(), none, noInts, noInts, 0,
+                              [call, sql](PGresult *res)
+                              {
+                                if (!res)
+                                {
+                                  call->done(nullptr); // connection failed, the op reports it
+                                  return;
+                                }
+                                bool ok = PQresultStatus(res) == PGRES_COMMAND_OK ||
+                                          hasSqlState(res, "42P05"); // duplicate_prepared_statement
+                                if (!ok)
+                                {
+                                  mt_logging::logger().log({fmt::format("Prepare {} failed, sending it unnamed: {}",
+                                                                        call->statement->name, PQresultErrorMessage(res)),
+                                                            mt_logging::LogLevel::Error,
+                                                            true});
+                                }
+                                PQclear(res);
+                                if (!ok)
+                                {
+                                  execUnnamed(*call->db, *call->statement, call->statement->sql,
+                                              *call->values, *call->lengths, *call->formats, std::move(call->done));
+                                  return;
+                                }
+                                setPrepared(*call->db, *call->statement, true);
+                                execute(std::move(call));
+                              });
+  }
+
+  static void execute(std::shared_ptr<PreparedCall> call)
+  {
+    static const std::vector<const char *> none;
+    static const std::vector<int> noInts;
+
+    metrics(*call->statement).prepared->inc();
+    call->db->asyncExecParams(call->execute.c_str(), none, noInts, noInts, 0,
+                              [call](PGresult *res)
+                              {
+                                // invalid_sql_statement_name: this connection lost the statement
+                                if (res && !call->retried && hasSqlState(res, "26000"))
+                                {
+                                  PQclear(res);
+                                  call->retried = true;
+                                  setPrepared(*call->db, *call->statement, false);
+                                  prepare(std::move(call));
+                                  return;
+                                }
+                                call->done(res);
+                              });
+  }
+
+  void exec(Rest::PQClient &db, Id id,
+            const std::vector<const char *> &values,
+            const std::vector<int> &lengths,
+            const std::vector<int> &formats,
+            std::function<void(PGresult *)> done)
+  {
+    exec(db, id, get(id).sql, values, lengths, formats, std::move(done));
+  }
+
+  void exec(Rest::PQClient &db, Id id, const char *sql,
+            const std::vector<const char *> &values,
+            const std::vector<int> &lengths,
+            const std::vector<int> &formats,
+            std::function<void(PGresult *)> done)
+  {
+    const Statement &statement = get(id);
+    if (sql != statement.sql)
+    {
+      execUnnamed(db, statement, sql, values, lengths, formats, std::move(done));
+      return;
+    }
+
+    auto call = std::make_shared<PreparedCall>(PreparedCall{&db, &statement, executeSql(statement, values, lengths, formats),
+                                                            std::move(done), &values, &lengths, &formats});
+    if (isPrepared(db, statement))
+      execute(std::move(call));
+    else
+      prepare(std::move(call));
+  }
+
+}
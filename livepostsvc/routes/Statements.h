@@ -0,0 +1,58 @@
+#pragma once
+
+#include "apiserver/HttpRoute.h"
+#include "apiserver/PQClient.h"
+#include <libpq-fe.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Every static route query under a stable statement name. A pooled connection prepares a
+// statement (SQL PREPARE) the first time an op runs it there; later calls EXECUTE it by name,
+// so Postgres reuses the parsed query and its cached plan. PQClient only has asyncExecParams
+// and EXECUTE takes no bind parameters, so the op's values go into the EXECUTE text as dollar
+// quoted literals. A connection that lost its statements (a reconnect, or a new PQClient at a
+// recycled address) answers SQLSTATE 26000; the statement is then prepared again and the call
+// retried once. /metrics has pg_statement_calls_total{statement,prepared} and
+// pg_statement_prepares_total{statement}.
+namespace Routes::Statements
+{
+  enum class Id
+  {
+    CreatePost,
+    CreateAuthor,
+    FetchPostsPage,
+    FetchPostsPageAfter,
+    StagePost,
+    FetchAuthor,
+  };
+
+  struct Statement
+  {
+    Id id;
+    const char *name; // PREPARE name
+    const char *sql;
+    std::vector<Oid> types; // per parameter, turns binary (format 1) values into literals
+  };
+
+  const std::vector<Statement> &all();
+  const Statement &get(Id id);
+
+  // Runs the statement on db by name, preparing it first when db has not yet. If the statement
+  // cannot be prepared its SQL is sent unnamed with the op's parameter arrays, which must
+  // outlive the call.
+  void exec(Rest::PQClient &db, Id id,
+            const std::vector<const char *> &values,
+            const std::vector<int> &lengths,
+            const std::vector<int> &formats,
+            std::function<void(PGresult *)> done);
+
+  // A variant of the statement's SQL (same parameters, e.g. a narrower SELECT list), counted
+  // under the statement's name. Variants are sent unnamed (prepared="false"); passing the
+  // statement's own sql runs it prepared. sql and the parameter arrays must outlive the call.
+  void exec(Rest::PQClient &db, Id id, const char *sql,
+            const std::vector<const char *> &values,
+            const std::vector<int> &lengths,
+            const std::vector<int> &formats,
+            std::function<void(PGresult *)> done);
+}